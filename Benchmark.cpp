@@ -0,0 +1,635 @@
+﻿#include <iostream>
+#include <vector>
+#include <cmath>
+#include <string>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "MemoryCounter.h"
+#include "Solution.h"
+#include "TestCase.h"
+#include "Generator.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Тестов на точку и зерно генератора
+const int TESTS_PER_POINT = 50;
+const unsigned int GENERATOR_SEED = 17239;
+
+// Проходов по open.txt при записи и сравнении базовой линии, задержка теста - медиана проходов
+const int REGRESSION_PASSES = 5;
+const string BASELINE_PATH = "baseline.txt";
+// Запас на шум машины: время считается хуже, только если весь 95% интервал отношения выше 1 + запас
+const double TIME_TOLERANCE = 0.03;
+
+// Эволюционный поиск: число самых трудных тестов open.txt и бюджет на тест по умолчанию
+const int EVOLVE_TESTS = 20;
+const double EVOLVE_BUDGET_MS = 1000;
+
+const string CAPTURE_PATH = "capture.bin";
+
+// Двухуровневое решение: тестов на точку, потребность пользователей масштабируется к ёмкости свободных блоков
+const int HIERARCHY_TESTS = 3;
+const double HIERARCHY_LOAD = 1.0;
+
+/// <summary>
+/// Прогон одной размерности: остальные параметры фиксированы в base
+/// </summary>
+struct Sweep {
+    string name;
+    GeneratorConfig base;
+    int GeneratorConfig::* field;
+    vector<int> values;
+};
+
+struct PointResult {
+    double average_us = 0;
+    double max_us = 0;
+    double score = 0;
+    size_t peak_bytes = 0;
+    double allocations = 0;
+};
+
+PointResult runPoint(const GeneratorConfig& config, unsigned int seed) {
+    mt19937 rng(seed);
+    vector<TestCase> tests;
+    for (int i = 0; i < TESTS_PER_POINT; i++) tests.push_back(generateTestCase(config, rng));
+
+    resetOrderStrategyStats();
+    memory_counter.resetPeak();
+    size_t base_bytes = memory_counter.current_bytes;
+
+    PointResult result;
+    size_t allocations = 0;
+    for (const auto& test : tests) {
+        size_t allocations_before = memory_counter.allocations;
+        auto start_time = steady_clock::now();
+        vector<Interval> output = Solver(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users);
+        double us = duration_cast<nanoseconds>(steady_clock::now() - start_time).count() / 1000.0;
+        // подсчёт оценки тоже выделяет память, учитывается только Solver
+        allocations += memory_counter.allocations - allocations_before;
+
+        result.average_us += us;
+        result.max_us = max(result.max_us, us);
+        result.score += getTestScore(test, output);
+    }
+
+    result.average_us /= tests.size();
+    result.score /= tests.size();
+    result.peak_bytes = memory_counter.peak_bytes - base_bytes;
+    result.allocations = (double)allocations / tests.size();
+    return result;
+}
+
+bool readCorpus(vector<TestCase>& tests) {
+    ifstream in("open.txt");
+    int tests_count;
+    if (!(in >> tests_count)) return false;
+    tests.clear();
+    for (int i = 0; i < tests_count; i++) tests.push_back(readTestCase(in));
+    return true;
+}
+
+/// <summary>
+/// Пакетное решение open.txt на 1, 2, 4, ... потоках до числа ядер: пропускная способность,
+/// ускорение относительно одного потока и хвост задержек экземпляров
+/// </summary>
+void runBatchScaling() {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "Batch: open.txt not found\n\n";
+        return;
+    }
+
+    vector<SolverTask> batch;
+    for (const auto& test : tests) batch.push_back({ test.N, test.M, test.K, test.J, test.L, &test.reserved, &test.users });
+
+    int cores = max(1, (int)thread::hardware_concurrency());
+    vector<int> thread_counts;
+    for (int threads = 1; threads < cores; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(cores);
+
+    cout << "Batch open.txt, cores: " << cores << '\n' << left;
+    cout << setw(8) << "threads" << setw(12) << "cells/s" << setw(10) << "speedup" << setw(12) << "p50 us"
+        << setw(12) << "p95 us" << setw(12) << "p99 us" << setw(12) << "max us" << setw(10) << "score" << '\n';
+
+    double single_thread_rate = 0;
+    vector<vector<Interval>> answers(tests.size());
+    for (int threads : thread_counts) {
+        BatchSolver solver(threads);
+        BatchStats stats;
+
+        // первый пакет прогревает буферы потоков
+        resetOrderStrategyStats();
+        solver.solve(batch, answers);
+        resetOrderStrategyStats();
+        solver.solve(batch, answers, &stats);
+
+        double score = 0;
+        for (int i = 0; i < (int)tests.size(); i++) score += getTestScore(tests[i], answers[i]);
+        score /= tests.size();
+
+        if (threads == 1) single_thread_rate = stats.cells_per_second;
+        cout << setw(8) << threads << fixed << setprecision(1) << setw(12) << stats.cells_per_second
+            << setprecision(2) << setw(10) << stats.cells_per_second / single_thread_rate << setprecision(1)
+            << setw(12) << stats.latency_p50_us << setw(12) << stats.latency_p95_us << setw(12) << stats.latency_p99_us
+            << setw(12) << stats.latency_max_us << setprecision(3) << setw(10) << score << '\n';
+        cout.flush();
+    }
+    cout << '\n';
+}
+
+/// <summary>
+/// Оценка и задержка каждого теста open.txt
+/// </summary>
+struct CorpusResult {
+    vector<float> scores;
+    vector<double> latency_us;
+};
+
+CorpusResult measureCorpus(const vector<TestCase>& tests) {
+    CorpusResult result;
+    result.scores.resize(tests.size());
+    vector<vector<double>> samples(tests.size());
+
+    setSolverSeed(12345);
+    vector<Interval> output;
+    for (int pass = 0; pass < REGRESSION_PASSES; pass++) {
+        // статистика стратегий влияет на следующие тесты, с чистой статистикой проходы совпадают
+        resetOrderStrategyStats();
+        for (int i = 0; i < (int)tests.size(); i++) {
+            const TestCase& test = tests[i];
+            auto start_time = steady_clock::now();
+            SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, output);
+            samples[i].push_back(duration_cast<nanoseconds>(steady_clock::now() - start_time).count() / 1000.0);
+            if (pass == 0) result.scores[i] = getTestScore(test, output);
+        }
+    }
+
+    for (auto& test_samples : samples) {
+        sort(test_samples.begin(), test_samples.end());
+        result.latency_us.push_back(test_samples[test_samples.size() / 2]);
+    }
+    return result;
+}
+
+/// <summary>
+/// Среднее и полуширина 95% доверительного интервала, нормальное приближение - тестов сотни
+/// </summary>
+pair<double, double> getMeanConfidence(const vector<double>& values) {
+    double mean = 0;
+    for (double value : values) mean += value;
+    mean /= values.size();
+
+    double variance = 0;
+    for (double value : values) variance += (value - mean) * (value - mean);
+    variance /= max(1, (int)values.size() - 1);
+
+    return { mean, 1.96 * sqrt(variance / values.size()) };
+}
+
+int recordBaseline(const string& path) {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "Baseline: open.txt not found\n";
+        return 1;
+    }
+
+    CorpusResult result = measureCorpus(tests);
+    ofstream out(path);
+    out << tests.size() << '\n' << setprecision(9);
+    for (int i = 0; i < (int)tests.size(); i++) out << result.scores[i] << ' ' << result.latency_us[i] << '\n';
+
+    double total_us = 0, score = 0;
+    for (int i = 0; i < (int)tests.size(); i++) {
+        total_us += result.latency_us[i];
+        score += result.scores[i];
+    }
+    cout << "Baseline " << path << ": " << tests.size() << " tests, " << fixed << setprecision(1) << total_us / 1000.0
+        << " ms, score " << setprecision(5) << score / tests.size() << '\n';
+    return 0;
+}
+
+/// <summary>
+/// Сравнение с базовой линией по парам тест - тест. Время - среднее логарифма отношения задержек,
+/// оценка - средняя разность. Возвращает 1, если время или оценка значимо хуже
+/// </summary>
+int compareBaseline(const string& path) {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "Baseline: open.txt not found\n";
+        return 1;
+    }
+
+    ifstream in(path);
+    int tests_count;
+    if (!(in >> tests_count) || tests_count != (int)tests.size()) {
+        cout << "Baseline: " << path << " is missing or recorded for another open.txt\n";
+        return 1;
+    }
+    CorpusResult baseline;
+    baseline.scores.resize(tests_count);
+    baseline.latency_us.resize(tests_count);
+    for (int i = 0; i < tests_count; i++) in >> baseline.scores[i] >> baseline.latency_us[i];
+
+    CorpusResult result = measureCorpus(tests);
+
+    vector<double> log_ratios, score_diffs;
+    for (int i = 0; i < tests_count; i++) {
+        log_ratios.push_back(log(result.latency_us[i] / baseline.latency_us[i]));
+        score_diffs.push_back(result.scores[i] - baseline.scores[i]);
+    }
+    pair<double, double> time = getMeanConfidence(log_ratios);
+    pair<double, double> score = getMeanConfidence(score_diffs);
+
+    bool time_worse = exp(time.first - time.second) > 1.0 + TIME_TOLERANCE;
+    bool score_worse = score.first + score.second < 0.0;
+
+    cout << fixed << setprecision(4);
+    cout << "Time ratio: " << exp(time.first) << " [" << exp(time.first - time.second) << ", " << exp(time.first + time.second) << "]"
+        << (time_worse ? " WORSE" : "") << '\n';
+    cout << setprecision(5);
+    cout << "Score diff: " << score.first << " [" << score.first - score.second << ", " << score.first + score.second << "]"
+        << (score_worse ? " WORSE" : "") << '\n';
+
+    // Худшие тесты для разбора
+    vector<int> order(tests_count);
+    for (int i = 0; i < tests_count; i++) order[i] = i;
+    sort(order.begin(), order.end(), [&](int l, int r) { return log_ratios[l] > log_ratios[r]; });
+    cout << "Slowest tests:";
+    for (int i = 0; i < min(5, tests_count); i++) cout << ' ' << order[i] + 1 << " (x" << setprecision(2) << exp(log_ratios[order[i]]) << ")";
+    cout << '\n';
+    sort(order.begin(), order.end(), [&](int l, int r) { return score_diffs[l] < score_diffs[r]; });
+    cout << "Worst scores:";
+    for (int i = 0; i < min(5, tests_count) && score_diffs[order[i]] < 0; i++) cout << ' ' << order[i] + 1 << " (" << setprecision(3) << score_diffs[order[i]] << ")";
+    cout << '\n';
+
+    return time_worse || score_worse ? 1 : 0;
+}
+
+/// <summary>
+/// Эволюционный поиск на самых трудных тестах open.txt.
+/// Для каждого теста оценка Solver и эволюции, затем средняя лучшая оценка checker
+/// по всем тестам в доли бюджета - сходимость поиска во времени
+/// </summary>
+int runEvolution(double budget_ms) {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "Evolve: open.txt not found\n";
+        return 1;
+    }
+
+    setSolverSeed(12345);
+    EvolutionParams params;
+    vector<Interval> answer;
+    vector<EvolutionPoint> convergence;
+
+    // Трудность - отставание лучшего порядка Solver от верхней оценки optimal_value.
+    // Низкая оценка теста сама по себе не годится: часто её не поднять из-за нехватки beam
+    vector<double> portfolio_scores(tests.size()), gaps(tests.size());
+    params.time_budget_ms = 0;
+    for (int i = 0; i < (int)tests.size(); i++) {
+        const TestCase& test = tests[i];
+        portfolio_scores[i] = getTestScore(test, Solver(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users));
+        SolverEvolve(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, params, answer, &convergence);
+        gaps[i] = convergence.empty() ? 0.0 : solver_context.optimal_value - convergence[0].best_value;
+    }
+
+    vector<int> hardest(tests.size());
+    for (int i = 0; i < (int)tests.size(); i++) hardest[i] = i;
+    sort(hardest.begin(), hardest.end(), [&](int l, int r) { return gaps[l] > gaps[r]; });
+    hardest.resize(min(EVOLVE_TESTS, (int)tests.size()));
+
+    params.time_budget_ms = budget_ms;
+
+    const vector<double> fractions = { 0.0, 0.05, 0.1, 0.25, 0.5, 0.75, 1.0 };
+    vector<double> convergence_sum(fractions.size());
+
+    cout << "Evolution, " << fixed << setprecision(0) << budget_ms << " ms per test\n" << left;
+    cout << setw(6) << "test" << setw(6) << "N" << setw(6) << "M" << setw(5) << "J" << setw(5) << "L"
+        << setw(12) << "solver" << setw(12) << "evolved" << setw(12) << "gens" << '\n';
+
+    double portfolio_total = 0, evolved_total = 0;
+    for (int index : hardest) {
+        const TestCase& test = tests[index];
+        SolverEvolve(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, params, answer, &convergence);
+        double score = getTestScore(test, answer);
+        portfolio_total += portfolio_scores[index];
+        evolved_total += score;
+
+        // лучшая оценка последнего поколения, законченного к моменту fraction * budget_ms
+        for (int k = 0; k < (int)fractions.size(); k++) {
+            float best = convergence.empty() ? 0.0f : convergence[0].best_value;
+            for (const auto& point : convergence) {
+                if (point.ms <= fractions[k] * budget_ms) best = point.best_value;
+            }
+            convergence_sum[k] += best;
+        }
+
+        cout << setw(6) << index + 1 << setw(6) << test.N << setw(6) << test.M << setw(5) << test.J << setw(5) << test.L
+            << setprecision(3) << setw(12) << portfolio_scores[index] << setw(12) << score
+            << setw(12) << (convergence.empty() ? 0 : convergence.back().generation) << '\n';
+        cout.flush();
+    }
+
+    int count = (int)hardest.size();
+    cout << "Average: solver " << setprecision(5) << portfolio_total / count << ", evolved " << evolved_total / count << "\n\n";
+    cout << "Convergence, average best fill\n";
+    for (int k = 0; k < (int)fractions.size(); k++) {
+        cout << setw(10) << setprecision(0) << fractions[k] * budget_ms << setprecision(5) << convergence_sum[k] / count << '\n';
+    }
+    return 0;
+}
+
+/// <summary>
+/// Захват решения open.txt в журнал - пример журнала и проверка формата
+/// </summary>
+int captureCorpus(const string& path) {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "Capture: open.txt not found\n";
+        return 1;
+    }
+    if (!startSolverCapture(path.c_str())) {
+        cout << "Capture: cannot open " << path << '\n';
+        return 1;
+    }
+
+    setSolverSeed(12345);
+    vector<Interval> answer;
+    for (const auto& test : tests) SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, answer);
+    uint64_t captured = solver_capture.captured, dropped = solver_capture.dropped;
+    stopSolverCapture();
+
+    cout << "Capture " << path << ": " << captured << " instances, " << dropped << " dropped\n";
+    return 0;
+}
+
+double getPercentile(vector<double> values, double p) {
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    return values[min((int)values.size() - 1, (int)(p * values.size()))];
+}
+
+/// <summary>
+/// Повтор журнала захвата текущей сборкой решателя: задержки и оценки записанных ответов
+/// против новых, по парам экземпляр - экземпляр
+/// </summary>
+int replayCapture(const string& path) {
+    vector<CapturedCase> cases;
+    if (!readCaptureLog(path, cases)) {
+        cout << "Replay: " << path << " is missing or not a capture log\n";
+        return 1;
+    }
+    if (cases.empty()) {
+        cout << "Replay: " << path << " is empty\n";
+        return 0;
+    }
+
+    setSolverSeed(12345);
+    vector<double> captured_us, replay_us, score_diffs;
+    double captured_score = 0, replay_score = 0;
+    int worse = 0;
+    vector<Interval> answer;
+    for (const auto& record : cases) {
+        const TestCase& test = record.test;
+        auto start_time = steady_clock::now();
+        SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, answer);
+        replay_us.push_back(duration_cast<nanoseconds>(steady_clock::now() - start_time).count() / 1000.0);
+        captured_us.push_back(record.latency_us);
+
+        double before = getTestScore(test, record.answer), after = getTestScore(test, answer);
+        captured_score += before;
+        replay_score += after;
+        score_diffs.push_back(after - before);
+        worse += after < before;
+    }
+
+    int count = (int)cases.size();
+    pair<double, double> score = getMeanConfidence(score_diffs);
+    cout << "Replay " << path << ": " << count << " instances\n" << left;
+    cout << setw(12) << "" << setw(12) << "mean us" << setw(12) << "p50 us" << setw(12) << "p95 us" << setw(12) << "p99 us" << setw(12) << "score" << '\n';
+    auto printRow = [&](const string& name, const vector<double>& us, double total_score) {
+        double mean = 0;
+        for (double value : us) mean += value;
+        cout << setw(12) << name << fixed << setprecision(1) << setw(12) << mean / count << setw(12) << getPercentile(us, 0.50)
+            << setw(12) << getPercentile(us, 0.95) << setw(12) << getPercentile(us, 0.99) << setprecision(5) << setw(12) << total_score / count << '\n';
+    };
+    printRow("captured", captured_us, captured_score);
+    printRow("replay", replay_us, replay_score);
+    cout << "Score diff: " << score.first << " [" << score.first - score.second << ", " << score.first + score.second << "], "
+        << worse << " instances worse\n";
+    return 0;
+}
+
+/// <summary>
+/// Версии ядер IntervalsSoA на open.txt: суммарная медианная задержка, ускорение относительно
+/// скалярной версии по парам тест - тест и число тестов, где оценка отличается от скалярной
+/// </summary>
+int compareIsa() {
+    vector<TestCase> tests;
+    if (!readCorpus(tests)) {
+        cout << "ISA: open.txt not found\n";
+        return 1;
+    }
+
+    SolverIsa detected = getSolverIsa();
+    cout << "Detected ISA: " << getSolverIsaName(detected) << '\n' << left;
+    cout << setw(12) << "ISA" << setw(12) << "ms" << setw(24) << "speedup" << setw(12) << "score" << setw(12) << "mismatches" << '\n';
+
+    CorpusResult scalar;
+    bool mismatch = false;
+    for (int isa = ISA_SCALAR; isa < ISA_COUNT; isa++) {
+        if (!setSolverIsa((SolverIsa)isa)) {
+            cout << setw(12) << getSolverIsaName((SolverIsa)isa) << "not supported\n";
+            continue;
+        }
+        CorpusResult result = measureCorpus(tests);
+        if (isa == ISA_SCALAR) scalar = result;
+
+        double total_us = 0, score = 0;
+        int mismatches = 0;
+        vector<double> log_ratios;
+        for (int i = 0; i < (int)tests.size(); i++) {
+            total_us += result.latency_us[i];
+            score += result.scores[i];
+            mismatches += result.scores[i] != scalar.scores[i];
+            log_ratios.push_back(log(scalar.latency_us[i] / result.latency_us[i]));
+        }
+        pair<double, double> speedup = getMeanConfidence(log_ratios);
+        mismatch |= mismatches > 0;
+
+        stringstream interval;
+        interval << fixed << setprecision(3) << exp(speedup.first) << " [" << exp(speedup.first - speedup.second) << ", " << exp(speedup.first + speedup.second) << "]";
+        cout << setw(12) << getSolverIsaName((SolverIsa)isa) << fixed << setprecision(1) << setw(12) << total_us / 1000.0
+            << setw(24) << interval.str() << setprecision(5) << setw(12) << score / tests.size() << setw(12) << mismatches << '\n';
+    }
+
+    setSolverIsa(detected);
+    return mismatch ? 1 : 0;
+}
+
+// Масштабирует rbNeed так, чтобы суммарная потребность была load ёмкостей свободных блоков
+void scaleDemand(TestCase& test, double load) {
+    long long total_need = 0;
+    for (const auto& user : test.users) total_need += user.rbNeed;
+    double factor = load * getMaxTestScore(test.M, test.L, test.reserved) / max(1LL, total_need);
+    for (auto& user : test.users) user.rbNeed = max(1, min(test.M, (int)round(user.rbNeed * factor)));
+}
+
+/// <summary>
+/// Двухуровневое решение против обычного Solver на сгенерированных экземплярах с тысячами пользователей:
+/// среднее время и оценка Solver, число групп, время SolverHierarchical на одном потоке и на всех ядрах,
+/// ускорение на всех ядрах относительно Solver и разность оценок
+/// </summary>
+int runHierarchy() {
+    struct HierarchyPoint {
+        int N, M, J, L;
+    };
+    vector<HierarchyPoint> points = {
+        { 1024, 8192, 64, 16 },
+        { 2048, 8192, 64, 16 },
+        { 4096, 8192, 64, 16 },
+        { 8192, 16384, 256, 32 },
+        { 16384, 16384, 256, 32 },
+    };
+
+    int cores = max(1, (int)thread::hardware_concurrency());
+    cout << "Hierarchical solve, load " << HIERARCHY_LOAD << ", cores: " << cores << '\n' << left;
+    cout << setw(8) << "N" << setw(8) << "M" << setw(6) << "J" << setw(6) << "L" << setw(12) << "flat ms" << setw(12) << "flat score"
+        << setw(8) << "groups" << setw(12) << "1 thr ms" << setw(12) << "all thr ms" << setw(10) << "speedup" << setw(12) << "score diff" << '\n';
+
+    mt19937 rng(GENERATOR_SEED);
+    vector<Interval> answer;
+    for (const auto& point : points) {
+        GeneratorConfig config;
+        config.N = point.N;
+        config.M = point.M;
+        config.K = 4;
+        config.J = point.J;
+        config.L = point.L;
+        config.beams = 32;
+
+        double flat_ms = 0, single_ms = 0, parallel_ms = 0, flat_score = 0, score = 0;
+        int groups = 1;
+        for (int t = 0; t < HIERARCHY_TESTS; t++) {
+            TestCase test = generateTestCase(config, rng);
+            scaleDemand(test, HIERARCHY_LOAD);
+
+            // с одним зерном и чистой статистикой стратегий прогоны сравнимы между собой
+            auto measure = [&](auto solve) {
+                setSolverSeed(12345);
+                resetOrderStrategyStats();
+                auto start_time = steady_clock::now();
+                solve();
+                return duration_cast<microseconds>(steady_clock::now() - start_time).count() / 1000.0;
+            };
+            HierarchyParams params;
+
+            flat_ms += measure([&]() { SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, answer); });
+            flat_score += getTestScore(test, answer);
+
+            params.threads = 1;
+            single_ms += measure([&]() { groups = SolverHierarchical(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, params, answer); });
+            score += getTestScore(test, answer);
+
+            params.threads = cores;
+            parallel_ms += measure([&]() { SolverHierarchical(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, params, answer); });
+        }
+
+        cout << setw(8) << point.N << setw(8) << point.M << setw(6) << point.J << setw(6) << point.L << fixed << setprecision(1)
+            << setw(12) << flat_ms / HIERARCHY_TESTS << setprecision(3) << setw(12) << flat_score / HIERARCHY_TESTS << setw(8) << groups
+            << setprecision(1) << setw(12) << single_ms / HIERARCHY_TESTS << setw(12) << parallel_ms / HIERARCHY_TESTS
+            << setprecision(2) << setw(10) << flat_ms / parallel_ms << setprecision(3) << setw(12) << (score - flat_score) / HIERARCHY_TESTS << '\n';
+        cout.flush();
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    ios_base::sync_with_stdio(false);
+
+    // Регрессия по open.txt: --record-baseline [файл] записывает, --compare-baseline [файл] сравнивает
+    string mode = argc > 1 ? argv[1] : "";
+    string path = argc > 2 ? argv[2] : BASELINE_PATH;
+    if (mode == "--record-baseline") return recordBaseline(path);
+    if (mode == "--compare-baseline") return compareBaseline(path);
+    // Эволюционный поиск порядка: --evolve [мс на тест]
+    if (mode == "--evolve") return runEvolution(argc > 2 ? atof(argv[2]) : EVOLVE_BUDGET_MS);
+    // Журнал захвата: --capture [файл] пишет решение open.txt, --replay [файл] повторяет журнал этой сборкой
+    if (mode == "--capture") return captureCorpus(argc > 2 ? argv[2] : CAPTURE_PATH);
+    if (mode == "--replay") return replayCapture(argc > 2 ? argv[2] : CAPTURE_PATH);
+    // Сравнение версий ядер: скалярная, AVX2, AVX-512
+    if (mode == "--isa") return compareIsa();
+    // Двухуровневое решение против Solver на экземплярах с тысячами пользователей
+    if (mode == "--hierarchy") return runHierarchy();
+
+    setSolverSeed(12345);
+
+    // Типичная точка open.txt, от неё масштабируется одна размерность
+    GeneratorConfig base;
+    base.N = 32;
+    base.M = 256;
+    base.K = 0;
+    base.J = 10;
+    base.L = 4;
+    base.beams = 8;
+
+    // L больше числа beam не используется, поэтому L масштабируется при 32 beam
+    GeneratorConfig wide = base;
+    wide.beams = 32;
+
+    vector<Sweep> sweeps = {
+        { "N", base, &GeneratorConfig::N, { 16, 32, 64, 128, 256, 512, 1024 } },
+        { "M", base, &GeneratorConfig::M, { 64, 128, 256, 512, 1024, 2048, 4096 } },
+        { "K", base, &GeneratorConfig::K, { 1, 2, 4, 8, 16 } },
+        { "J", base, &GeneratorConfig::J, { 4, 8, 16, 32, 64 } },
+        { "L", wide, &GeneratorConfig::L, { 2, 4, 8, 16, 32 } },
+        { "beams", base, &GeneratorConfig::beams, { 2, 4, 8, 16, 32 } },
+    };
+
+    // Распределение open.txt для сравнения
+    {
+        PointResult result = runPoint(GeneratorConfig(), GENERATOR_SEED);
+        cout << "open.txt-like: " << fixed << setprecision(1) << result.average_us << " us, score " << setprecision(3) << result.score << "\n\n";
+    }
+
+    runBatchScaling();
+
+    for (const auto& sweep : sweeps) {
+        cout << "Sweep " << sweep.name << '\n' << left;
+        cout << setw(8) << sweep.name << setw(12) << "avg us" << setw(12) << "max us" << setw(10) << "growth"
+            << setw(12) << "peak KB" << setw(12) << "allocs" << setw(10) << "score" << '\n';
+
+        double previous_us = 0;
+        int previous_value = 0;
+        for (int value : sweep.values) {
+            GeneratorConfig config = sweep.base;
+            config.*sweep.field = value;
+            PointResult result = runPoint(config, GENERATOR_SEED + value);
+
+            // Показатель степени роста между соседними точками, больше 1 - сверхлинейный рост
+            string growth = "-";
+            if (previous_value > 0 && previous_us > 0) {
+                double exponent = log(result.average_us / previous_us) / log((double)value / previous_value);
+                ostringstream out;
+                out << fixed << setprecision(2) << exponent;
+                growth = out.str();
+            }
+
+            cout << setw(8) << value << fixed << setprecision(1) << setw(12) << result.average_us << setw(12) << result.max_us
+                << setw(10) << growth << setw(12) << result.peak_bytes / 1024.0 << setw(12) << result.allocations
+                << setprecision(3) << setw(10) << result.score << '\n';
+            cout.flush();
+
+            previous_us = result.average_us;
+            previous_value = value;
+        }
+        cout << '\n';
+    }
+}
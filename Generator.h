@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "TestCase.h"
+
+using namespace std;
+
+/// <summary>
+/// Параметры генератора. Значение -1 - взять из распределения open.txt,
+/// иначе параметр фиксирован, так каждую размерность можно масштабировать отдельно
+/// </summary>
+struct GeneratorConfig {
+    int N = -1;
+    int M = -1;
+    int K = -1;
+    int J = -1;
+    int L = -1;
+    // количество различных beam, не больше 32
+    int beams = -1;
+};
+
+// Выбор индекса с весами, веса сняты с open.txt
+inline int sampleWeighted(mt19937& rng, const vector<int>& weights) {
+    discrete_distribution<int> distribution(weights.begin(), weights.end());
+    return distribution(rng);
+}
+
+/// <summary>
+/// Случайный тест. По умолчанию повторяет распределение open.txt:
+/// N от 20 до 128 (больше половины до 32), M от 64 до 512, K от 0 до 3, J от 4 до 16,
+/// L от 2 до 16, число beam около L, rbNeed лог-равномерно от 1 до доли M
+/// </summary>
+inline TestCase generateTestCase(const GeneratorConfig& config, mt19937& rng) {
+    auto uniform = [&rng](int from, int to) { return uniform_int_distribution<int>(from, to)(rng); };
+
+    TestCase test;
+
+    if (config.N >= 0) test.N = config.N;
+    else {
+        int group = sampleWeighted(rng, { 529, 376, 95 });
+        test.N = group == 0 ? uniform(20, 32) : group == 1 ? uniform(33, 64) : uniform(65, 128);
+    }
+    test.M = config.M >= 0 ? config.M : uniform(64, 512);
+    test.K = config.K >= 0 ? config.K : sampleWeighted(rng, { 666, 215, 80, 39 });
+    test.J = config.J >= 0 ? config.J : uniform(4, 16);
+    test.L = config.L >= 0 ? config.L : 2 + sampleWeighted(rng, { 103, 180, 164, 129, 80, 60, 57, 40, 32, 12, 21, 24, 22, 10, 66 });
+
+    // Число beam в open.txt держится около L: разность от -4 до 14, чаще всего 0..2
+    int beams_count = config.beams >= 0 ? config.beams : test.L - 4 + sampleWeighted(rng, { 2, 16, 41, 134, 235, 192, 173, 90, 40, 25, 15, 16, 10, 3, 2, 4, 0, 1, 1 });
+    beams_count = max(config.beams >= 0 ? 1 : 2, min(32, min(test.N, beams_count)));
+
+    // Зарезервированные интервалы не пересекаются, длина до 4% M.
+    // Если место кончилось, K получается меньше запрошенного
+    for (int attempt = 0; (int)test.reserved.size() < test.K && attempt < 100 * test.K; attempt++) {
+        int length = max(1, (int)(test.M * uniform(2, 40) / 1000));
+        int start = uniform(0, test.M - length);
+        bool overlaps = false;
+        for (const auto& R : test.reserved) overlaps |= start < R.end && R.start < start + length;
+        if (overlaps) continue;
+        test.reserved.push_back(Interval(start, start + length));
+    }
+    sort(test.reserved.begin(), test.reserved.end(), [](const Interval& l, const Interval& r) { return l.start < r.start; });
+    test.K = (int)test.reserved.size();
+
+    vector<int> beam_ids(32);
+    for (int i = 0; i < 32; i++) beam_ids[i] = i;
+    shuffle(beam_ids.begin(), beam_ids.end(), rng);
+    beam_ids.resize(beams_count);
+
+    // Верхняя граница rbNeed теста - от 20% до 100% M
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    double max_need = test.M * (0.2 + 0.8 * unit(rng));
+    test.users.resize(test.N);
+    for (int i = 0; i < test.N; i++) {
+        test.users[i].id = i;
+        test.users[i].rbNeed = max(1, min(test.M, (int)round(exp(unit(rng) * log(max_need)))));
+        test.users[i].beam = beam_ids[i < beams_count ? i : uniform(0, beams_count - 1)];
+    }
+
+    return test;
+}
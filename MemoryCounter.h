@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <atomic>
+
+/// <summary>
+/// Подсчёт выделений кучи через замену глобальных operator new/delete.
+/// Подключать только в одну единицу трансляции исполняемого файла. Счётчики атомарные,
+/// выделения из потоков BatchSolver тоже учитываются. Отдельно ведутся счётчики каждого потока
+/// </summary>
+struct MemoryCounter {
+    std::atomic<size_t> allocations{ 0 };
+    std::atomic<size_t> current_bytes{ 0 };
+    std::atomic<size_t> peak_bytes{ 0 };
+
+    // Пик считается заново от текущего объёма
+    void resetPeak() {
+        peak_bytes = current_bytes.load();
+    }
+};
+
+MemoryCounter memory_counter;
+
+/// <summary>
+/// Счётчики потока: выделения и байты с его начала, живые байты и их пик. Блок, освобождённый
+/// другим потоком, уменьшает живые байты освободившего, поэтому live_bytes бывает отрицательным
+/// </summary>
+struct ThreadMemoryCounter {
+    size_t allocations;
+    size_t bytes;
+    long long live_bytes;
+    long long peak_bytes;
+};
+
+// без конструктора, чтобы operator new работал и до инициализации потока
+thread_local ThreadMemoryCounter thread_memory_counter;
+
+/// <summary>
+/// Снимок счётчиков текущего потока в Sample с полями allocations, bytes, live_bytes, peak_bytes.
+/// reset_peak начинает пик заново от текущего объёма. Подходит как MemorySampler для
+/// setSolverMemorySampler(sampleThreadMemory<MemorySample>)
+/// </summary>
+template <class Sample>
+void sampleThreadMemory(Sample& sample, bool reset_peak) {
+    ThreadMemoryCounter& counter = thread_memory_counter;
+    if (reset_peak) counter.peak_bytes = counter.live_bytes;
+    sample.allocations = counter.allocations;
+    sample.bytes = counter.bytes;
+    sample.live_bytes = counter.live_bytes;
+    sample.peak_bytes = counter.peak_bytes;
+}
+
+// Перед блоком хранится его размер, выравнивание сохраняется
+static const size_t MEMORY_COUNTER_HEADER = alignof(std::max_align_t);
+
+inline void* countedAllocate(size_t size) {
+    void* block = std::malloc(size + MEMORY_COUNTER_HEADER);
+    if (block == nullptr) std::abort();
+    *(size_t*)block = size;
+    ++memory_counter.allocations;
+    size_t current = memory_counter.current_bytes += size;
+    size_t peak = memory_counter.peak_bytes;
+    while (current > peak && !memory_counter.peak_bytes.compare_exchange_weak(peak, current)) {}
+
+    ThreadMemoryCounter& counter = thread_memory_counter;
+    ++counter.allocations;
+    counter.bytes += size;
+    counter.live_bytes += size;
+    if (counter.live_bytes > counter.peak_bytes) counter.peak_bytes = counter.live_bytes;
+    return (char*)block + MEMORY_COUNTER_HEADER;
+}
+
+inline void countedFree(void* pointer) {
+    if (pointer == nullptr) return;
+    void* block = (char*)pointer - MEMORY_COUNTER_HEADER;
+    memory_counter.current_bytes -= *(size_t*)block;
+    thread_memory_counter.live_bytes -= (long long)*(size_t*)block;
+    std::free(block);
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void operator delete(void* pointer) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer) noexcept { countedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { countedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { countedFree(pointer); }
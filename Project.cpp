@@ -1,204 +1,408 @@
-﻿#include <iostream>
-#include <vector>
-#include <cmath>
-#include <algorithm>
-#include <string>
-#include <map>
-#include <unordered_map>
-#include <set>
-#include <unordered_set>
-#include <queue>
-#include <deque>
-#include <bitset>
-#include <random>
-#include <fstream>
-#include <iomanip>
-#include <chrono>
-
-#include "Solution.h"
-
-using namespace std;
-using namespace std::chrono;
-
-// [START_TEST, END_TEST], 1 <= START_TEST, defines might be commented
-#define START_TEST 1
-#define END_TEST 1000
-
-const bool LOGS_ENABLED = false;
-
-void printIntervals(const vector<Interval>& output) {
-    cout << "Intervals: " << output.size() << '\n' << left;
-    cout << setw(10) << "Begin" << setw(10) << "End" << setw(10) << "Users" << '\n';
-    for (const auto& interval : output) {
-        cout << setw(10) << interval.start << setw(10) << interval.end;
-        for (const auto& user : interval.users) {
-            cout << user << " ";
-        }
-        cout << '\n';
-    }
-}
-
-void printMaskedIntervals(const vector<MaskedInterval>& output) {
-    cout << "Intervals: " << output.size() << '\n' << left;
-    cout << setw(10) << "Begin" << setw(10) << "End" << setw(10) << "Users" << '\n';
-    for (const auto& interval : output) {
-        cout << setw(10) << interval.start << setw(10) << interval.end;
-        for (const auto& user : interval.users) {
-            cout << user << " ";
-        }
-        cout << '\n';
-    }
-}
-
-float run(bool logs_flag) {
-    ifstream in("open.txt");
-
-    int __cnt_of_tests__;
-    in >> __cnt_of_tests__;
-
-    int __start_test__ = 0;
-
-#ifdef START_TEST
-    __start_test__ = START_TEST - 1;
-#endif // START_TEST
-
-#ifdef END_TEST
-    __cnt_of_tests__ = END_TEST;
-#endif // END_TEST
-
-    //setStepLogger(logs_flag ? printMaskedIntervals : nullptr);
-
-    float all_tests_score = 0.0f;
-    for (int __test_case__ = __start_test__; __test_case__ < __cnt_of_tests__; __test_case__++) {
-        int N, M, K, J, L;
-        in >> N >> M >> K >> J >> L;
-
-        vector<Interval> reserved(K);
-        for (int i = 0; i < K; i++) {
-            int start, end;
-            in >> start >> end;
-            reserved[i].start = start;
-            reserved[i].end = end;
-        }
-
-        vector<UserInfo> users(N);
-        for (int i = 0; i < N; i++) {
-            int rbNeed, beam;
-            in >> rbNeed >> beam;
-            users[i].id = i;
-            users[i].rbNeed = rbNeed;
-            users[i].beam = beam;
-        }
-
-        if (logs_flag) {
-            cout << "Test: " << __test_case__ + 1 << '\n';
-        }
-
-        vector<Interval> output = Solver(N, M, K, J, L, reserved, users);
-
-        int output_score = 0;
-        int max_user_score = 0;
-
-        map<int, int> user_metrics;
-        for (const auto& interval : output) {
-            for (int user_id : interval.users) {
-                user_metrics[user_id] += interval.end - interval.start;
-            }
-        }
-
-        set<int> beams;
-        for (auto& u : users) beams.insert(u.beam);
-
-        int max_test_score = M;
-        for (const auto& R : reserved) {
-            max_test_score -= R.end - R.start;
-        }
-        max_test_score *= L;
-
-        for (const auto& U : users) {
-            max_user_score += U.rbNeed;
-            output_score += min(U.rbNeed, user_metrics[U.id]);
-        }
-
-        int total_score = min(max_user_score, max_test_score);
-        float test_score = output_score * 100.0f / total_score;
-        all_tests_score += test_score;
-
-        if (logs_flag) {
-            printIntervals(output);
-            cout << "Filled: " << test_score << "%" << '\n';
-        }
-    }
-
-    return all_tests_score / (__cnt_of_tests__ - __start_test__);
-}
-
-int main() {
-
-    /*
-    float d = 1e-1;
-    float best = 0;
-    float b1, b2;
-    int best_at;
-    for (int at = 1; at <= 8; at++) {
-        setMaxAttempts(at);
-        for (float p1 = -2.0f; p1 <= 2.0f; p1 += d) {
-            for (float p2 = 0.0f; p2 <= 1.0f; p2 += d) {
-                setHyperParams(p1, p2);
-                float res = run(false);
-                if (res > best) {
-                    best = res;
-                    b1 = p1;
-                    b2 = p2;
-                    best_at = at;
-                    cout << at << " " << p1 << " " << p2 << " " << res << '\n';
-                }
-            }
-        }
-    }
-    */
-
-    //float res = 0;
-    //for (int i = 0; i < 500; i++) {
-    //    res += run(LOGS_ENABLED);
-    //}
-    //cout << res / 500 << "-middle\n";
-
-    ios_base::sync_with_stdio(false);
-    cin.tie(nullptr);
-    cout.tie(nullptr);
-
-    auto start_time = high_resolution_clock::now();
-
-    cout << "Average filled: " << run(LOGS_ENABLED) << "%" << '\n';
-
-    auto stop_time = high_resolution_clock::now();
-    auto duration = duration_cast<milliseconds>(stop_time - start_time);
-
-    // double because 1000 of 2000 tests
-    cout << "Time x2 taken by function: " << duration.count() * 2 << " ms" << '\n';
-
-    cout << "Bests: " << '\n';
-    const auto& metrics = getTestMetrics();
-    set<pair<int, int>> sorted_metrics;
-    for (const auto& p : metrics) {
-        sorted_metrics.insert(p);
-    }
-
-    for (const auto& p : sorted_metrics) {
-        cout << p.first << ": " << p.second << '\n';
-    }
-
-    cout << "Stress test\n";
-    float minValue = 100.0f;
-    float maxValue = 0.0f;
-    float average = 0.0f;
-    for (int i = 0; i < 100; i++) {
-        float value = run(false);
-        average += value;
-        minValue = min(minValue, value);
-        maxValue = max(maxValue, value);
-    }
-    average /= 100;
-    cout << "Average: " << average << " Min: " << minValue << " Max: " << maxValue << endl;
+﻿#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <set>
+#include <unordered_set>
+#include <queue>
+#include <deque>
+#include <bitset>
+#include <random>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include "MemoryCounter.h"
+#include "Solution.h"
+#include "TestCase.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// [START_TEST, END_TEST], 1 <= START_TEST, defines might be commented
+#define START_TEST 1
+#define END_TEST 1000
+
+const bool LOGS_ENABLED = false;
+
+// Подбор параметров по классам экземпляров вместо обычного запуска
+const bool TUNING_ENABLED = false;
+
+// run конвейером: чтение и оценка идут параллельно с решением
+const bool PIPELINE_ENABLED = true;
+// Решающих потоков конвейера, 0 - по числу ядер. При одном потоке вызовы Solver идут в том же порядке,
+// что и без конвейера, и вывод совпадает с последовательным. Больше одного - быстрее, но статистика
+// стратегий общая для потоков, оценки зависят от их чередования
+const int PIPELINE_SOLVER_THREADS = 1;
+// Тестов в работе одновременно: прочитанных, решаемых и ждущих оценки
+const int PIPELINE_SLOTS = 64;
+
+void printIntervals(const vector<Interval>& output) {
+    cout << "Intervals: " << output.size() << '\n' << left;
+    cout << setw(10) << "Begin" << setw(10) << "End" << setw(10) << "Users" << '\n';
+    for (const auto& interval : output) {
+        cout << setw(10) << interval.start << setw(10) << interval.end;
+        for (const auto& user : interval.users) {
+            cout << user << " ";
+        }
+        cout << '\n';
+    }
+}
+
+// Тесты [first_test, last_test) по одному: чтение, решение, оценка
+float runSequential(istream& in, int first_test, int last_test, bool logs_flag) {
+    float all_tests_score = 0.0f;
+    for (int __test_case__ = first_test; __test_case__ < last_test; __test_case__++) {
+        TestCase test = readTestCase(in);
+
+        if (logs_flag) {
+            cout << "Test: " << __test_case__ + 1 << '\n';
+        }
+
+        vector<Interval> output = Solver(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users);
+
+        float test_score = getTestScore(test, output);
+        all_tests_score += test_score;
+
+        if (logs_flag) {
+            printIntervals(output);
+            cout << "Filled: " << test_score << "%" << '\n';
+        }
+    }
+    return all_tests_score;
+}
+
+/// <summary>
+/// Ячейка кольца конвейера. stage = 4 * номер теста + этап: 0 - ячейка свободна для теста,
+/// 1 - тест прочитан, 2 - решён. Ячейкой по очереди владеют читатель, решатель и оценщик,
+/// владение передаётся записью stage, поэтому между этапами нет блокировок
+/// </summary>
+struct PipelineSlot {
+    atomic<size_t> stage{ 0 };
+    TestCase test;
+    vector<Interval> output;
+
+    void wait(size_t expected) const {
+        while (stage.load(memory_order_acquire) != expected) this_thread::yield();
+    }
+};
+
+/// <summary>
+/// Тесты [first_test, last_test) конвейером: поток чтения, threads решающих потоков и оценка
+/// с печатью в вызывающем потоке. Кольцо из PIPELINE_SLOTS ячеек ограничивает число тестов в работе.
+/// Решения раздаются, а оценка и печать идут в порядке тестов
+/// </summary>
+float runPipelined(istream& in, int first_test, int last_test, bool logs_flag, int threads) {
+    int count = last_test - first_test;
+    unique_ptr<PipelineSlot[]> slots(new PipelineSlot[PIPELINE_SLOTS]);
+    for (int k = 0; k < PIPELINE_SLOTS; k++) slots[k].stage.store(4 * (size_t)k, memory_order_relaxed);
+
+    thread reader([&]() {
+        for (int i = 0; i < count; i++) {
+            PipelineSlot& slot = slots[i % PIPELINE_SLOTS];
+            slot.wait(4 * (size_t)i);
+            slot.test = readTestCase(in);
+            slot.stage.store(4 * (size_t)i + 1, memory_order_release);
+        }
+    });
+
+    // тесты раздаются по порядку, поэтому ячейка теста всегда в кольце
+    atomic<int> next_test{ 0 };
+    vector<thread> solvers;
+    for (int t = 0; t < threads; t++) {
+        solvers.emplace_back([&]() {
+            for (int i = next_test++; i < count; i = next_test++) {
+                PipelineSlot& slot = slots[i % PIPELINE_SLOTS];
+                slot.wait(4 * (size_t)i + 1);
+                const TestCase& test = slot.test;
+                SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, slot.output);
+                slot.stage.store(4 * (size_t)i + 2, memory_order_release);
+            }
+        });
+    }
+
+    float all_tests_score = 0.0f;
+    for (int i = 0; i < count; i++) {
+        PipelineSlot& slot = slots[i % PIPELINE_SLOTS];
+        slot.wait(4 * (size_t)i + 2);
+
+        float test_score = getTestScore(slot.test, slot.output);
+        all_tests_score += test_score;
+
+        if (logs_flag) {
+            cout << "Test: " << first_test + i + 1 << '\n';
+            printIntervals(slot.output);
+            cout << "Filled: " << test_score << "%" << '\n';
+        }
+        slot.stage.store(4 * (size_t)(i + PIPELINE_SLOTS), memory_order_release);
+    }
+
+    reader.join();
+    for (auto& solver : solvers) solver.join();
+    return all_tests_score;
+}
+
+float run(bool logs_flag) {
+    ifstream in("open.txt");
+
+    int __cnt_of_tests__;
+    in >> __cnt_of_tests__;
+
+    int __start_test__ = 0;
+
+#ifdef START_TEST
+    __start_test__ = START_TEST - 1;
+#endif // START_TEST
+
+#ifdef END_TEST
+    __cnt_of_tests__ = END_TEST;
+#endif // END_TEST
+
+    int threads = PIPELINE_SOLVER_THREADS > 0 ? PIPELINE_SOLVER_THREADS : max(1, (int)thread::hardware_concurrency());
+    float all_tests_score = PIPELINE_ENABLED ?
+        runPipelined(in, __start_test__, __cnt_of_tests__, logs_flag, threads) :
+        runSequential(in, __start_test__, __cnt_of_tests__, logs_flag);
+
+    return all_tests_score / (__cnt_of_tests__ - __start_test__);
+}
+
+// Средняя оценка на подмножестве тестов с фиксированным зерном и чистой статистикой стратегий
+float evaluateTests(const vector<TestCase>& tests, const vector<int>& indices) {
+    if (indices.empty()) return 0.0f;
+
+    resetOrderStrategyStats();
+    float score = 0.0f;
+    for (int index : indices) {
+        const TestCase& test = tests[index];
+        score += getTestScore(test, Solver(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users));
+    }
+    return score / indices.size();
+}
+
+/// <summary>
+/// Число выделений памяти Solver в установившемся режиме. Первый проход по тестам через SolverInto
+/// заполняет рабочие буферы и ответы, второй такой же проход должен обойтись без кучи
+/// </summary>
+size_t countSteadyStateAllocations() {
+    ifstream in("open.txt");
+    int tests_count;
+    in >> tests_count;
+    vector<TestCase> tests;
+    for (int i = 0; i < tests_count; i++) tests.push_back(readTestCase(in));
+
+    // проходы совпадают: то же зерно и та же статистика стратегий
+    setSolverSeed(12345);
+    vector<vector<Interval>> answers(tests_count);
+    size_t allocations = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        resetOrderStrategyStats();
+        size_t allocations_before = memory_counter.allocations;
+        for (int i = 0; i < tests_count; i++) {
+            const TestCase& test = tests[i];
+            SolverInto(test.N, test.M, test.K, test.J, test.L, test.reserved, test.users, answers[i]);
+        }
+        allocations = memory_counter.allocations - allocations_before;
+    }
+
+    setSolverSeed(0);
+    resetOrderStrategyStats();
+    return allocations;
+}
+
+/// <summary>
+/// Подбор SolverParams для каждого класса экземпляров. Покоординатный спуск по сетке
+/// на чётных тестах класса, проверка на нечётных. Таблица пишется в path в виде
+/// инициализатора instance_class_params для Solution.h
+/// </summary>
+void tuneInstanceClasses(const string& path) {
+    ifstream in("open.txt");
+    int tests_count;
+    in >> tests_count;
+    vector<TestCase> tests;
+    for (int i = 0; i < tests_count; i++) tests.push_back(readTestCase(in));
+
+    setInstanceClassParamsEnabled(false);
+    setSolverSeed(12345);
+
+    vector<vector<int>> train(INSTANCE_CLASSES), validation(INSTANCE_CLASSES);
+    for (int i = 0; i < tests_count; i++) {
+        const TestCase& test = tests[i];
+        int instance_class = getInstanceClass(test.M, test.J, test.L, test.reserved, test.users);
+        (i % 2 == 0 ? train : validation)[instance_class].push_back(i);
+    }
+
+    const SolverParams defaults = default_solver_params;
+    auto evaluate = [&](const SolverParams& params, const vector<int>& indices) {
+        default_solver_params = params;
+        return evaluateTests(tests, indices);
+    };
+
+    vector<SolverParams> table(INSTANCE_CLASSES, defaults);
+    for (int c = 0; c < INSTANCE_CLASSES; c++) {
+        SolverParams best = defaults;
+        float best_score = evaluate(best, train[c]);
+        float default_score = best_score;
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int a = -10; a <= 2; a++) {
+                for (int b = 5; b <= 12; b++) {
+                    SolverParams params = best;
+                    params.loss_threshold_multiplier_A = a * 0.1f;
+                    params.loss_threshold_multiplier_B = b * 0.1f;
+                    float score = evaluate(params, train[c]);
+                    if (score > best_score) {
+                        best_score = score;
+                        best = params;
+                    }
+                }
+            }
+            for (int attempts = 1; attempts <= 6; attempts++) {
+                SolverParams params = best;
+                params.max_attempts = attempts;
+                float score = evaluate(params, train[c]);
+                if (score > best_score) {
+                    best_score = score;
+                    best = params;
+                }
+            }
+            for (int threshold : { 25, 50, 75, 100, 150, 200, 300 }) {
+                SolverParams params = best;
+                params.last_split_attempt_threshold = threshold;
+                float score = evaluate(params, train[c]);
+                if (score > best_score) {
+                    best_score = score;
+                    best = params;
+                }
+            }
+        }
+
+        float default_validation = evaluate(defaults, validation[c]);
+        float tuned_validation = evaluate(best, validation[c]);
+        if (tuned_validation >= default_validation) table[c] = best;
+
+        cout << "Class " << c << " tests: " << train[c].size() + validation[c].size()
+            << " train: " << default_score << " -> " << best_score
+            << " validation: " << default_validation << " -> " << tuned_validation
+            << (tuned_validation >= default_validation ? "" : " (rejected)") << endl;
+    }
+
+    default_solver_params = defaults;
+    setInstanceClassParamsEnabled(true);
+    setSolverSeed(0);
+
+    ofstream out(path);
+    out << fixed << setprecision(3);
+    for (int c = 0; c < INSTANCE_CLASSES; c++) {
+        const SolverParams& params = table[c];
+        out << "    { " << params.loss_threshold_multiplier_A << "f, " << params.loss_threshold_multiplier_B << "f, "
+            << params.max_attempts << ", " << params.last_split_attempt_threshold << " },"
+            << " // " << c << '\n';
+    }
+}
+
+// Выделения и пики памяти на вызов Solver: среднее и худший вызов, по фазам
+void printSolverMemory() {
+    SolverMemoryTotals totals = getSolverMemoryTotals();
+    if (totals.calls == 0) return;
+
+    const char* names[MEMORY_PHASES] = { "prepare", "runs", "finish" };
+    streamsize precision = cout.precision();
+    auto print = [&](const string& name, const PhaseMemory& sum, const PhaseMemory& maximum) {
+        cout << left << setw(10) << name << right << fixed << setprecision(1)
+            << " allocs avg " << setw(8) << (double)sum.allocations / totals.calls << " max " << setw(6) << maximum.allocations
+            << "  KB avg " << setw(8) << sum.bytes / 1024.0 / totals.calls << " max " << setw(8) << maximum.bytes / 1024.0
+            << "  peak KB avg " << setw(8) << sum.peak_bytes / 1024.0 / totals.calls << " max " << setw(8) << maximum.peak_bytes / 1024.0 << '\n';
+    };
+    cout << "Memory per Solver call (" << totals.calls << " calls):\n";
+    print("call", totals.sum.call, totals.max.call);
+    for (int i = 0; i < MEMORY_PHASES; i++) print(names[i], totals.sum.phases[i], totals.max.phases[i]);
+    cout.unsetf(ios_base::floatfield);
+    cout.precision(precision);
+}
+
+int main() {
+
+    if (TUNING_ENABLED) {
+        tuneInstanceClasses("instance_params.txt");
+        return 0;
+    }
+
+    //float res = 0;
+    //for (int i = 0; i < 500; i++) {
+    //    res += run(LOGS_ENABLED);
+    //}
+    //cout << res / 500 << "-middle\n";
+
+    ios_base::sync_with_stdio(false);
+    cin.tie(nullptr);
+    cout.tie(nullptr);
+
+    // Профиль памяти вызовов Solver по счётчикам MemoryCounter.h
+    setSolverMemorySampler(sampleThreadMemory<MemorySample>);
+    resetSolverMemoryTotals();
+
+    auto start_time = high_resolution_clock::now();
+
+#ifdef SOLVER_TRACE
+    // Шаги realSolver первого прогона, читаются trace_reader.py
+    traceOpen("trace.bin");
+#endif
+
+    cout << "Average filled: " << run(LOGS_ENABLED) << "%" << '\n';
+
+#ifdef SOLVER_TRACE
+    traceClose();
+#endif
+
+    auto stop_time = high_resolution_clock::now();
+    auto duration = duration_cast<milliseconds>(stop_time - start_time);
+
+    // double because 1000 of 2000 tests
+    cout << "Time x2 taken by function: " << duration.count() * 2 << " ms" << '\n';
+    printSolverMemory();
+
+    cout << "Bests: " << '\n';
+    const auto& metrics = getTestMetrics();
+    set<pair<int, int>> sorted_metrics;
+    for (const auto& p : metrics) {
+        sorted_metrics.insert(p);
+    }
+
+    for (const auto& p : sorted_metrics) {
+        cout << p.first << ": " << p.second << '\n';
+    }
+
+    cout << "Strategies: " << '\n';
+    for (const auto& strategy : getOrderStrategies()) {
+        cout << left << setw(16) << strategy.name << right
+            << " runs: " << strategy.runs
+            << " wins: " << strategy.wins
+            << " avg gain: " << (strategy.runs > 0 ? strategy.gain / strategy.runs : 0.0)
+            << " skipped: " << strategy.skipped << '\n';
+    }
+
+    // Проверки инвариантов выделяют память на каждом шаге
+#ifndef SOLVER_CHECK_INVARIANTS
+    size_t allocations = countSteadyStateAllocations();
+    cout << "Steady state allocations: " << allocations << (allocations == 0 ? "" : " FAILED") << '\n';
+#endif
+
+    cout << "Stress test\n";
+    float minValue = 100.0f;
+    float maxValue = 0.0f;
+    float average = 0.0f;
+    for (int i = 0; i < 100; i++) {
+        float value = run(false);
+        average += value;
+        minValue = min(minValue, value);
+        maxValue = max(maxValue, value);
+    }
+    average /= 100;
+    cout << "Average: " << average << " Min: " << minValue << " Max: " << maxValue << endl;
 }
\ No newline at end of file
@@ -1,1043 +1,4314 @@
-﻿#pragma once
-
-#pragma GCC optimize ("O3,function-inlining")
-#pragma GCC target("avx2,bmi,bmi2")
-
-#include <iostream>
-#include <vector>
-#include <cmath>
-#include <algorithm>
-#include <string>
-#include <map>
-#include <unordered_map>
-#include <set>
-#include <unordered_set>
-#include <queue>
-#include <deque>
-#include <bitset>
-#include <random>
-#include <fstream>
-#include <iomanip>
-#include <chrono>
-#include <climits>
-#include <cstdlib>
-#include <cinttypes>
-#include <utility>
-#include <cstdlib>
-#include <time.h>
-#include <cstdint>
-#include <limits.h>
-#include <type_traits>
-
-using namespace std;
-
-struct Interval {
-    int start, end;
-    vector<int> users;
-
-    Interval() : start(0), end(0) {}
-    Interval(int start, int end) : start(start), end(end) {}
-};
-
-
-struct UserInfo {
-    int rbNeed;
-    int beam;
-    int id;
-};
-
-//float loss_threshold_multiplier_A = -0.172f;
-//float loss_threshold_multiplier_B = 0.906f;
-//
-//int max_attempts = 3;
-
-// В среднем на 0.002% лучше, лучший случай улучшился, худший немного ухудшился
-float loss_threshold_multiplier_A = -0.283f;
-float loss_threshold_multiplier_B = 0.972f;
-
-int max_attempts = 3;
-
-// минимальная длина свободной части отрезка чтобы произвошло разделение
-int last_split_attempt_threshold = 100;
-
-unordered_map<int, int> test_metrics;
-
-vector<UserInfo> user_data;
-
-vector<pair<int, int>> user_intervals;
-
-void setHyperParams(float a, float b) {
-    loss_threshold_multiplier_A = a;
-    loss_threshold_multiplier_B = b;
-}
-
-void setMaxAttempts(int V) {
-    max_attempts = V;
-}
-
-unordered_map<int, int>& getTestMetrics() {
-    return test_metrics;
-}
-
-struct UserSetComparator {
-    bool operator()(int id1, int id2) const {
-        const UserInfo& U1 = user_data[id1];
-        const UserInfo& U2 = user_data[id2];
-        if (U1.rbNeed == U2.rbNeed) {
-            return U1.beam > U2.beam;
-        }
-        return U1.rbNeed > U2.rbNeed;
-    }
-};
-
-struct MaskedInterval : public Interval {
-
-    unsigned int mask = 0;
-    int mask_indices[32];
-
-    MaskedInterval(int start, int end) : Interval(start, end) {}
-
-    int getLength() const {
-        return end - start;
-    }
-
-    bool hasMaskCollision(const UserInfo& user) const {
-        return (mask & (1 << user.beam)) != 0;
-    }
-
-    int getMaxLoss() const {
-        return max(0, end - user_intervals[users.back()].second);
-    }
-
-    void eraseUser(int user_id) {
-        if (!hasMaskCollision(user_data[user_id])) return;
-
-        int beam = user_data[user_id].beam;
-        int index = mask_indices[beam];
-        if (users[index] != user_id) return;
-        mask ^= (1 << beam);
-        users.erase(users.begin() + index);
-        for (int i = 0; i < users.size(); ++i) mask_indices[user_data[users[i]].beam] = i;
-    }
-
-    void insertSplitUser(const UserInfo& user) {
-        if (user_intervals[user.id].first == -1) {
-            throw "Error in the function \"insertSplitUser\": user_intervals[user.id].first != -1";
-        }
-
-        users.push_back(user.id);
-        mask |= (1 << user.beam);
-        mask_indices[user.beam] = users.size() - 1;
-    }
-
-    void insertNewUser(const UserInfo& user) {
-        if (user_intervals[user.id].first != -1) {
-            throw "Error in the function \"insertNewUser\": user_intervals[user.id].first == -1";
-        }
-
-        // Вставка с сортировкой
-        int i = 0;
-        for (; i < users.size(); ++i) {
-            int new_user_bound = start + user.rbNeed;
-            int old_user_bound = user_intervals[users[i]].second;
-            if (new_user_bound >= old_user_bound) {
-                break;
-            }
-        }
-
-        if (i == users.size()) {
-            users.push_back(user.id);
-        }
-        else {
-            users.insert(users.begin() + i, user.id);
-        }
-
-
-        user_intervals[user.id] = { start, min(end, start + user.rbNeed) };
-
-        mask |= (1 << user.beam);
-        for (int i = 0; i < users.size(); ++i) mask_indices[user_data[users[i]].beam] = i;
-    }
-
-    bool canBeDeferred(int user_index) const {
-        int user_id = users[user_index];
-        return user_intervals[user_id].first == start && user_intervals[user_id].second <= end;
-    }
-
-    int replaceUser(const UserInfo& user, int index) {
-
-        int deferred_index = -1;
-        if (index < users.size()) {
-            if (canBeDeferred(index)) {
-                deferred_index = users[index];
-            }
-
-            int user_id = users[index];
-            if (user_intervals[user_id].second > end) {
-                throw "Error in the function \"replaceUser\": user_intervals[user_id].second <= end";
-            }
-
-            if (user_intervals[user_id].first < start) {
-                user_intervals[user_id].second = start; // Оставили только левую часть
-            }
-            else {
-                user_intervals[user_id] = { -1, -1 }; // Пользователь удален полностью
-            }
-
-            mask_indices[user_data[user_id].beam] = -1;
-            mask ^= (1 << user_data[user_id].beam);
-            users.erase(users.begin() + index);
-        }
-
-        insertNewUser(user);
-
-        return deferred_index;
-    }
-
-    pair<int, int> getInsertionProfit(const UserInfo& user, int L) const {
-
-        if (hasMaskCollision(user)) {
-            int index = mask_indices[user.beam];
-            int user_id = users[index];
-            return { min(end, start + user.rbNeed) - min(end, user_intervals[user_id].second), index };
-        }
-
-        if (users.size() < L) {
-            return { min(end - start, user.rbNeed), users.size() };
-        }
-
-        int index = (int)users.size() - 1;
-        int profit = min(end, start + user.rbNeed) - min(end, user_intervals[users.back()].second);
-
-        return { profit, index };
-    }
-
-    pair<int, int> getReduceProfit(const UserInfo& user) const {
-
-        if (user.rbNeed < getLength()) return { -1, -1 };
-
-        if (hasMaskCollision(user)) {
-            int index = mask_indices[user.beam];
-            int user_id = users[index];
-            int old_user_bound = user_intervals[user_id].first + user_data[user_id].rbNeed;
-            int new_user_bound = start + user.rbNeed;
-            if (old_user_bound <= end || !canBeDeferred(index)) return { -1, -1 };
-            return { max(0, old_user_bound - new_user_bound), index };
-        }
-
-        for (int i = 0; i < users.size(); ++i) {
-            int user_id = users[i];
-            int old_user_bound = user_intervals[user_id].first + user_data[user_id].rbNeed;
-            int new_user_bound = start + user.rbNeed;
-            if (old_user_bound <= end) break;
-            if (canBeDeferred(i)) {
-                return { max(0, old_user_bound - new_user_bound), i };
-            }
-        }
-
-        return { -1, -1 };
-    }
-};
-
-void (*log_step) (const vector<MaskedInterval>& intervals);
-
-inline void setStepLogger(void (*logger) (const vector<MaskedInterval>& intervals)) {
-    log_step = logger;
-}
-
-inline bool sortUsersByRbNeedDescendingComp(uint8_t id1, uint8_t id2) {
-    const UserInfo& U1 = user_data[id1];
-    const UserInfo& U2 = user_data[id2];
-
-    if (U1.rbNeed == U2.rbNeed) {
-        if (U1.beam == U2.beam) return id1 > id2;
-        return U1.beam > U2.beam;
-    }
-    return U1.rbNeed > U2.rbNeed;
-}
-
-inline bool sortIntervalsDescendingComp(const MaskedInterval& I1, const MaskedInterval& I2) {
-
-    int l1 = I1.getLength(), l2 = I2.getLength();
-
-    if (l1 == l2) {
-        int users1 = I1.users.size(), users2 = I2.users.size();
-        return users1 > users2;
-    }
-
-    return l1 > l2;
-}
-
-inline vector<MaskedInterval> getNonReservedIntervals(const vector<Interval>& reserved, int M) {
-
-    int start = 0;
-    vector<MaskedInterval> result; result.reserve(10);
-    for (int i = 0; i < reserved.size(); ++i) {
-        if (start < reserved[i].start) {
-            result.push_back(MaskedInterval(start, reserved[i].start));
-            start = reserved[i].end;
-        }
-    }
-
-    if (start < M) {
-        result.push_back({ start, M });
-    }
-
-    return result;
-}
-
-inline int getSplitIndex(const MaskedInterval& interval, float loss_threshold) {
-    /*
-        \         |
-         \        |
-           \      |
-              \   |-------------| loss
-        -.-.-.-.-.-.-.-.-.-.-.-.- startSplitIndex
-                  \
-                  |       \
-                  |             \
-        Все что справа от черты округляется вправо, слева округляется по черте
-        до разделения округление было вправо для всех
-
-        Если разделение по loss не произошло, но есть свободное место на последнем уровне > last_split_attempt_threshold, то произойдет разделение по последнему
-    */
-
-    int start_split_index = 0;
-    for (; start_split_index < interval.users.size(); ++start_split_index) {
-        float loss = interval.end - min(interval.end, user_intervals[interval.users[start_split_index]].second);
-        if (loss > loss_threshold) {
-            break;
-        }
-    }
-
-    if (start_split_index == interval.users.size() && interval.users.size() > 0 && interval.getMaxLoss() > last_split_attempt_threshold) {
-        start_split_index--;
-    }
-
-    return start_split_index;
-}
-
-inline pair<int, int> getSplitPositionAndIndex(vector<MaskedInterval>& intervals, int index, float loss_threshold) {
-    MaskedInterval& interval = intervals[index];
-    int length = interval.getLength();
-    if (length < 2) {
-        return { -1, -1 };
-    }
-
-    int start_split_index = getSplitIndex(interval, loss_threshold);
-    if (start_split_index == interval.users.size()) {
-        return { -1, -1 };
-    }
-
-    int middle_position = user_intervals[interval.users[start_split_index]].second;
-    if (middle_position <= interval.start || middle_position >= interval.end) {
-        return { -1, -1 };
-    }
-
-    return { middle_position, start_split_index };
-}
-
-/// <summary>
-/// Разделяет интервал для экономии места, при этом счёт не уменьшается
-/// |-----|    |--|  |
-/// |-----| -> |--|  |
-/// |-----|    |-----|
-/// |-----|    |-----|
-/// </summary>
-inline bool trySplitInterval(vector<MaskedInterval>& intervals, int index, float loss_threshold) {
-
-    pair<int, int> split = getSplitPositionAndIndex(intervals, index, loss_threshold);
-    int middle_position = split.first;
-    int start_split_index = split.second;
-    if (middle_position == -1) return false;
-
-
-    MaskedInterval& interval = intervals[index]; 
-    MaskedInterval intL(interval.start, middle_position);
-    MaskedInterval intR(middle_position, interval.end);
-
-    for (int i = 0; i < interval.users.size(); i++) {
-        if (user_intervals[interval.users[i]].second > middle_position) {
-            intR.insertSplitUser(user_data[interval.users[i]]);
-        }
-        intL.insertSplitUser(user_data[interval.users[i]]);
-    }
-
-    intervals[index] = intR;
-    intervals.push_back(intL);
-
-    return true;
-}
-
-inline float getLossThresholdMultiplier(int user_index, int users_count) {
-    float x = (float)user_index / users_count;
-    return loss_threshold_multiplier_A * x + loss_threshold_multiplier_B;
-}
-
-inline bool tryReplaceUser(vector<MaskedInterval>& intervals, const UserInfo& user, int replace_threshold, int overfill_threshold, int L, set<uint8_t, UserSetComparator>& deferred, bool reinsert) {
-
-    int best_index = -1;
-    int best_overfill = INT_MAX;
-
-    pair<float, int> best_profit = { 0, -1 };
-
-    for (int i = 0; i < intervals.size(); ++i) {
-        if (intervals[i].users.size() == L) {
-            if (intervals[i].getMaxLoss() <= replace_threshold) continue;
-            if (user_intervals[intervals[i].users.back()].second > intervals[i].start + user.rbNeed) continue;
-        }
-
-        int overfill = user.rbNeed - intervals[i].getLength();
-        if (overfill > overfill_threshold) continue;
-        pair<int, int> profit = intervals[i].getInsertionProfit(user, L);
-        float x = (float)i / intervals.size();
-        x *= x;
-        x *= x;
-        x *= x;
-
-        float coef = 1.0f + -x;
-        float scaledProfit = profit.first * coef;
-        if (scaledProfit >= best_profit.first) {
-            best_overfill = overfill;
-            best_profit = { scaledProfit, profit.second };
-            best_index = i;
-        }
-    }
-
-    if (best_profit.first > replace_threshold && best_index != -1) {
-        int deferred_index = intervals[best_index].replaceUser(user, best_profit.second);
-        if (reinsert && deferred_index >= 0) {
-            deferred.insert(deferred_index);
-        }
-        return true;
-    }
-
-    return false;
-}
-
-inline bool tryReduceUser(vector<MaskedInterval>& intervals, const UserInfo& user, int replace_threshold, set<uint8_t, UserSetComparator >& deferred) {
-
-    int best_index = -1;
-    pair<int, int> best_profit = { 0, -1 };
-
-    for (int i = 0; i < intervals.size(); ++i) {
-        pair<int, int> profit = intervals[i].getReduceProfit(user);
-        if (profit.first > best_profit.first) {
-            best_profit = profit;
-            best_index = i;
-        }
-    }
-
-    if (best_profit.first > replace_threshold && best_index != -1) {
-        int deferred_index = intervals[best_index].replaceUser(user, best_profit.second);
-        if (deferred_index == -1) {
-            throw "Error in the function \"tryReduceUser\": deferred_index == -1";
-        }
-
-        deferred.insert(deferred_index);
-        return true;
-    }
-
-    return false;
-}
-
-inline int findInsertIndex(vector<MaskedInterval>& intervals, const UserInfo& user, int L) {
-
-    int first_or_shortest = -1;
-    int min_filled = L - 1;
-    for (int i = 0; i < intervals.size(); ++i) {
-
-        auto& interval = intervals[i];
-        if (interval.getLength() < user.rbNeed) break;
-        if (interval.hasMaskCollision(user)) continue;
-
-        if (interval.users.size() <= min_filled) {
-            first_or_shortest = i;
-            min_filled = interval.users.size();
-        }
-    }
-
-    return first_or_shortest;
-}
-
-inline int findIntervalToSplit(vector<MaskedInterval>& intervals, const UserInfo& user, float loss_threshold_multiplier, int L) {
-
-    float minPosition = 1000;
-    int maxProfit = 0;
-    int minLoss = 1000;
-    int optimal_index = -1;
-    for (int i = 0; i < intervals.size(); i++) {
-        float loss_threshold = user.rbNeed * loss_threshold_multiplier;
-
-        auto res = getSplitPositionAndIndex(intervals, i, loss_threshold);
-        if (res.first != -1) {
-            float value = res.second;
-            int profit = intervals[i].getInsertionProfit(user, L).first;
-
-            if (value < minPosition || value == minPosition && profit > maxProfit) {
-                minPosition = value;
-                maxProfit = profit;
-                optimal_index = i;
-            }
-        }
-    }
-    return optimal_index;
-}
-
-
-inline bool splitRoutine(vector<MaskedInterval>& intervals, const UserInfo& user, int index, float loss_threshold_multiplier) {
-    if (index == -1) {
-        throw "Error in the function \"splitRoutine\": index == -1";
-    }
-
-    // Здесь почему то нужно ограничивать а при поиске нет, надо бы разобраться почему
-    float lossThreshold = min(intervals[index].getLength(), user.rbNeed) * loss_threshold_multiplier;
-    trySplitInterval(intervals, index, lossThreshold);
-    sort(intervals.begin(), intervals.end(), sortIntervalsDescendingComp);
-
-    return false;
-}
-
-inline void reinsertRoutine(vector<MaskedInterval>& intervals, int N, int L) {
-    // оптимизация перевставкой
-    for (size_t i = 0; i < N; i++) {
-        if (user_intervals[i].first == -1) continue;
-        int fill = user_intervals[i].second - user_intervals[i].first;
-        if (fill >= user_data[i].rbNeed) continue;
-
-        int max_profit = 0;
-        int optimal_index = -1;
-        for (size_t j = 0; j < intervals.size(); ++j) {
-            auto& interval = intervals[j];
-            if (interval.getLength() <= fill) break;
-            if (interval.users.size() >= L || interval.hasMaskCollision(user_data[i])) continue;
-
-            int new_length = min(user_data[i].rbNeed, interval.getLength());
-            int profit = new_length - fill;
-            if (profit >= max_profit) {
-                max_profit = profit;
-                optimal_index = j;
-            }
-        }
-
-        if (optimal_index == -1) continue;
-
-        // delete
-        for (auto& interval : intervals) interval.eraseUser(i);
-        user_intervals[i] = { -1, -1 };
-        intervals[optimal_index].insertNewUser(user_data[i]);
-    }
-}
-
-inline int getMaxTestScore(int M, int L, const vector<Interval>& reserved) {
-
-    int max_test_score = M;
-    for (const auto& R : reserved) {
-        max_test_score -= R.end - R.start;
-    }
-
-    return max_test_score;
-}
-
-inline bool move_bounds_right(vector<MaskedInterval>& intervals, vector<pair<int, int>> actual_user_intervals) {
-    vector<int> right_intervals(actual_user_intervals.size());
-    bool success = false;
-
-    for (size_t i = 0; i < intervals.size(); ++i) {
-        for (auto u : intervals[i].users) right_intervals[u] = i;
-    }
-
-    for (size_t i = 1; i < intervals.size(); ++i) {
-        MaskedInterval& right = intervals[i];
-        MaskedInterval& left = intervals[i - 1];
-
-        if (left.end != right.start || right.getLength() <= 1) {
-            continue;
-        }
-
-        int rightLoss = 0;
-        for (auto u : right.users) {
-            if (actual_user_intervals[u].first == -1) throw - 1;
-            if (actual_user_intervals[u].second == intervals[right_intervals[u]].end) rightLoss++;
-        }
-        int leftProfit = 0;
-        for (auto u : left.users) {
-            if (actual_user_intervals[u].first == -1) throw - 1;
-            if (actual_user_intervals[u].second != left.end) continue;
-            int fill = actual_user_intervals[u].second - actual_user_intervals[u].first;
-            if (fill < user_data[u].rbNeed) leftProfit++;
-        }
-
-        if (leftProfit > rightLoss) {
-            // move right
-            for (auto u : left.users)
-                if (actual_user_intervals[u].second = left.end)
-                    if (actual_user_intervals[u].second - actual_user_intervals[u].first < user_data[u].rbNeed)
-                        actual_user_intervals[u].second++;
-
-            for (auto u : right.users) {
-                if (actual_user_intervals[u].first == right.start) {
-                    actual_user_intervals[u].first++;
-                    actual_user_intervals[u].second = min(intervals[right_intervals[u]].end, actual_user_intervals[u].second + 1);
-                }
-            }
-
-            left.end++;
-            right.start++;
-            success = true;
-        }
-    }
-
-    return success;
-}
-
-inline bool move_bounds_left(vector<MaskedInterval>& intervals, vector<pair<int, int>>& actual_user_intervals) {
-    // двигать границы интервалов
-    bool success = false;
-    for (size_t i = intervals.size() - 1; i >= 1; --i) {
-        MaskedInterval& right = intervals[i];
-        MaskedInterval& left = intervals[i - 1];
-
-        if (left.end != right.start) {
-            continue;
-        }
-
-        int leftLoss = 0;
-        for (auto u : left.users) {
-            if (actual_user_intervals[u].first == -1) throw - 1;
-            if (actual_user_intervals[u].second == left.end) leftLoss++;
-        }
-        int rightProfit = 0;
-        for (auto u : right.users) {
-            if (actual_user_intervals[u].first == -1) throw - 1;
-            if (actual_user_intervals[u].first != right.start) continue;
-            int fill = actual_user_intervals[u].second - actual_user_intervals[u].first;
-            if (fill < user_data[u].rbNeed) rightProfit++;
-        }
-
-        if (rightProfit > leftLoss && left.getLength() > 1) {
-            // move left
-            for (auto u : left.users)
-                if (actual_user_intervals[u].second == left.end)
-                    --actual_user_intervals[u].second;
-            for (auto u : right.users)
-                if (actual_user_intervals[u].first == right.start) {
-                    --actual_user_intervals[u].first;
-                    if (actual_user_intervals[u].second - actual_user_intervals[u].first > user_data[u].rbNeed)
-                        --actual_user_intervals[u].second;
-                }
-            left.end--;
-            right.start--;
-            success = true;
-        }
-    }
-    return success;
-}
-
-inline float checker(int N, int M, int K, int J, int L, int max_test_score_row) {
-
-    int output_score = 0;
-
-    for (size_t i = 0; i < N; ++i) {
-        if (user_intervals[i].first != -1) {
-            output_score += user_intervals[i].second - user_intervals[i].first;
-        }
-    }
-
-    int totalScore = max_test_score_row * L;
-    float testScore = output_score * 100.0f / (float)totalScore;
-
-    return testScore;
-}
-
-void riffle_shuffle(vector<uint8_t>& vec, int startIndex, int endIndex) {
-    int i = (startIndex + endIndex) / 2;
-    int j = endIndex - 1;
-    while (i > startIndex) {
-        uint8_t temp = vec[i];
-        vec[i--] = vec[j];
-        vec[j--] = temp;
-    }
-}
-
-void shuffle(vector<uint8_t>& vec, int startIndex, int endIndex) {
-    int length = endIndex - startIndex;
-    for (int i = endIndex - 1; i > startIndex; --i) {
-        int index = rand() % length;
-        uint8_t temp = vec[i];
-        vec[i] = vec[startIndex + index];
-        vec[startIndex + index] = temp;
-    }
-}
-
-vector<MaskedInterval> realSolver(int N, int M, int K, int J, int L, vector<MaskedInterval> reservedRBs, const vector<uint8_t>& user_infos);
-
-/// <summary>
-/// Функция решения задачи
-/// </summary>
-/// <param name="N">Количество пользователей</param>
-/// <param name="M">Количество блоков передачи данных</param>
-/// <param name="K">Количество зарезервированных интервалов передачи данных</param>
-/// <param name="J">Максимальное количество интервалов с пользователями</param>
-/// <param name="L">Максимальное количество пользователей на одном интервале</param>
-/// <param name="reservedRBs">Зарезервированные интервалы</param>
-/// <param name="userInfos">Информация о пользователях</param>
-/// <returns>Интервалы передачи данных, до J штук</returns>
-vector<Interval> Solver(int N, int M, int K, int J, int L, vector<Interval> reservedRBs, vector<UserInfo> userInfos) {
-
-    bool random_enable = true;
-
-    srand((unsigned int)time(0));
-
-    int max_test_score = getMaxTestScore(M, L, reservedRBs);
-
-    user_data = userInfos;
-
-    vector<uint8_t> userIndices(N);
-    for (int i = 0; i < N; ++i) userIndices[i] = userInfos[i].id;
-    sort(userIndices.begin(), userIndices.end(), sortUsersByRbNeedDescendingComp);
-
-    vector<MaskedInterval> intervals = getNonReservedIntervals(reservedRBs, M);
-    sort(intervals.begin(), intervals.end(), sortIntervalsDescendingComp);
-
-    set<int> beams;
-    for (const auto& user : userInfos) beams.insert(user.beam);
-    int maxInsertions = min(L, (int)beams.size());
-
-    int best_test_index = 1;
-
-    float best_value = 0;
-    vector<uint8_t> userInfosMy;
-    vector<MaskedInterval> result;
-    vector<pair<int, int>> actual_user_intervals;
-
-    // Просчёт с просто отсортированными отрезками
-    try {
-        userInfosMy = userIndices;
-        result = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-        best_value = checker(N, M, K, J, maxInsertions, max_test_score);
-        actual_user_intervals = user_intervals;
-    }
-    catch (...) {}
-
-    // Попытки улучшить
-    float curr_value = 0;
-    vector<MaskedInterval> temp; 
-
-    //#2 - Инверсия блоков длины 4 в отсортированном массиве
-    try {
-        userInfosMy = userIndices;
-        for (int i = 0; i < userInfosMy.size(); i += 4) {
-            if (i + 3 < userInfosMy.size()) {
-                swap(userInfosMy[i], userInfosMy[i + 3]);
-                swap(userInfosMy[i + 1], userInfosMy[i + 2]);
-            }
-        }
-        temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-        curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-        if (curr_value > best_value) {
-            best_test_index = 2;
-            best_value = curr_value;
-            result = temp;
-            actual_user_intervals = user_intervals;
-        }
-    }
-    catch (...) {}
-
-    //#3 - Свапы соседних в отсортированном массиве
-    try {
-        userInfosMy = userIndices;
-        for (int i = 0; i < userInfosMy.size(); i += 2) {
-            if (i + 1 < userInfosMy.size()) {
-                swap(userInfosMy[i], userInfosMy[i + 1]);
-            }
-        }
-        temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-        curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-        if (curr_value > best_value) {
-            best_test_index = 3;
-            best_value = curr_value;
-            result = temp;
-            actual_user_intervals = user_intervals;
-        }
-    }
-    catch (...) {}
-
-    //#4 - Инверсия блоков длины 3 в отсортированном массиве
-    try {
-        userInfosMy = userIndices;
-        for (int i = 0; i < userInfosMy.size(); i += 3) {
-            if (i + 2 < userInfosMy.size()) {
-                swap(userInfosMy[i], userInfosMy[i + 2]);
-            }
-        }
-        temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-        curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-        if (curr_value > best_value) {
-            best_test_index = 4;
-            best_value = curr_value;
-            result = temp;
-            actual_user_intervals = user_intervals;
-        }
-    }
-    catch (...) {}
-
-    //#5 - Хитрая инверсия блоков длины 6 в отсортированном массиве
-    try {
-        userInfosMy = userIndices;
-        for (int i = 0; i < userInfosMy.size(); i += 6) {
-            if (i + 5 < userInfosMy.size()) {
-                swap(userInfosMy[i], userInfosMy[i + 5]);
-                //swap(userInfosMy[i + 1], userInfosMy[i + 4]);
-                swap(userInfosMy[i + 2], userInfosMy[i + 3]);
-            }
-        }
-        temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-        curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-        if (curr_value > best_value) {
-            best_test_index = 5;
-            best_value = curr_value;
-            result = temp;
-            actual_user_intervals = user_intervals;
-        }
-    }
-    catch (...) {}
-
-
-    //#6 - random_shuffle блоков разной в отсортированном массиве
-    try {
-        for (int j = 3; j < 13 && random_enable; j++) {
-            userInfosMy = userIndices;
-            int curr_size = j + 3;
-            for (int i = 0; i < userInfosMy.size(); i += curr_size) {
-                if (i + curr_size < userInfosMy.size()) {
-                    shuffle(userInfosMy, i, i + curr_size);
-                }
-            }
-            temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-            curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-            if (curr_value > best_value) {
-                best_test_index = 6;
-                best_value = curr_value;
-                result = temp;
-                actual_user_intervals = user_intervals;
-
-            }
-        }
-        for (int j = 1; j < 6 && random_enable; j++) {
-            userInfosMy = userIndices;
-            int curr_size = j + 4;
-            for (int i = 0; i < userInfosMy.size(); i += curr_size) {
-                if (i + curr_size < userInfosMy.size()) {
-                    riffle_shuffle(userInfosMy, i, i + curr_size);
-                }
-            }
-            temp = realSolver(N, M, K, J, maxInsertions, intervals, userInfosMy);
-            curr_value = checker(N, M, K, J, maxInsertions, max_test_score);
-            if (curr_value > best_value) {
-                best_test_index = 6;
-                best_value = curr_value;
-                result = temp;
-                actual_user_intervals = user_intervals;
-            }
-        }
-    }
-    catch (...) {}
-
-    ++test_metrics[best_test_index];
-
-    sort(result.begin(), result.end(), [](const MaskedInterval& l, const MaskedInterval& r) { return l.start < r.start; });
-    int max_iterations = 50;
-    while (max_iterations-- && (move_bounds_left(result, actual_user_intervals) || move_bounds_right(result, actual_user_intervals))) {}
-
-    // перераспределение пользователей по частотам
-    {
-        vector<int> userLengths(N, 0);
-        vector<uint8_t> insertedUsers;
-        insertedUsers.reserve(N);
-
-        for (const auto& interval : result) {
-            for (auto u : interval.users) {
-                if (userLengths[u] == 0) insertedUsers.push_back(u);
-                userLengths[u] += interval.end - interval.start;
-            }
-        }
-
-        sort(insertedUsers.begin(), insertedUsers.end(), [&userLengths](const uint8_t id1, const uint8_t id2) {
-            if (user_data[id1].beam == user_data[id2].beam) return userLengths[id1] > userLengths[id2];
-            return user_data[id1].beam < user_data[id2].beam;
-            });
-
-        sort(userInfos.begin(), userInfos.end(), [](const UserInfo& U1, const UserInfo& U2) {
-            if (U1.beam == U2.beam) return U1.rbNeed > U2.rbNeed;
-            return U1.beam < U2.beam;
-            });
-
-        unordered_map<int, int> old2new;
-        int indexNew = 0;
-        for (int i = 0; i < insertedUsers.size(); ++i, ++indexNew) {
-            while (userInfos[indexNew].beam != user_data[insertedUsers[i]].beam) ++indexNew;
-
-            old2new[insertedUsers[i]] = userInfos[indexNew].id;
-        }
-
-        for (auto& interval : result) {
-            for (auto& u : interval.users) {
-                u = old2new[u];
-            }
-        }
-
-        actual_user_intervals.assign(N, { -1,-1 });
-        vector<int> userStarts(N, -1);
-        vector<int> userEnds(N, -1);
-        for (const auto& interval : result) {
-            for (auto u : interval.users) {
-                if (userStarts[u] == -1) userStarts[u] = interval.start;
-                userEnds[u] = interval.end;
-            }
-        }
-        for (int i = 0; i < N; ++i) {
-            if (userStarts[i] == -1) continue;
-            actual_user_intervals[i] = { userStarts[i], min(userEnds[i], userStarts[i] + user_data[i].rbNeed) };
-        }
-    }
-    max_iterations = 50;
-    while (max_iterations-- && (move_bounds_left(result, actual_user_intervals) || move_bounds_right(result, actual_user_intervals))) {}
-
-    // Формируем ответ
-    vector<Interval> answer(J);
-    int j = 0;
-    for (int i = 0; j < J && i < result.size(); ++i) {
-        if (result[i].users.size() > 0) {
-            answer[j++] = result[i];
-        }
-    }
-
-    while (answer.size() > j) {
-        answer.pop_back();
-    }
-
-    return answer;
-}
-
-inline vector<MaskedInterval> realSolver(int N, int M, int K, int J, int L, vector<MaskedInterval> intervals, const vector<uint8_t>& user_infos) {
-
-    user_intervals.assign(user_infos.size(), { -1, -1 });
-
-    set<uint8_t, UserSetComparator> deferred;
-
-    int attempt = 0;
-
-    int user_index = 0;
-    while (user_index < user_infos.size()) {
-        if (log_step != nullptr) log_step(intervals);
-
-        ++attempt;
-        bool inserted = false;
-        const UserInfo& user = user_data[user_infos[user_index]];
-
-        int insertion_index = findInsertIndex(intervals, user, L);
-
-        // Eсли нет пустой ячейки то попробовать заменить что-то
-        if (insertion_index >= 0) {
-            intervals[insertion_index].insertNewUser(user);
-            inserted = true;
-        }
-        else {
-            bool success = false;
-            auto it = deferred.begin();
-            while (it != deferred.end()) {
-                bool result = tryReplaceUser(intervals, user_data[*it], 2, 250, L, deferred, true);
-                auto last_it = it;
-                ++it;
-                if (result) {
-                    success = true;
-                    deferred.erase(last_it);
-                }
-            }
-            if (success) continue;
-        }
-
-        if (inserted || attempt >= max_attempts) {
-            if (!inserted) {
-                deferred.insert(user.id);
-            }
-            attempt = 0;
-            ++user_index;
-        }
-        else {
-            if (intervals.size() < J) {
-                if (intervals[0].getLength() > user.rbNeed) {
-                    float loss_threshold_multiplier = getLossThresholdMultiplier(user_index, N);
-
-                    // Заменить слишком больших пользователей на тех кто поменьше и разделить
-                    int split_index = findIntervalToSplit(intervals, user, loss_threshold_multiplier, L);
-                    if (split_index != -1) {
-                        auto it = deferred.begin();
-                        while (it != deferred.end()) {
-                            bool result = tryReduceUser(intervals, user_data[*it], 0, deferred);
-                            auto last_it = it;
-                            ++it;
-                            if (result) {
-                                deferred.erase(last_it);
-                            }
-                        }
-                        splitRoutine(intervals, user, split_index, loss_threshold_multiplier);
-                        reinsertRoutine(intervals, N, L);
-                        continue;
-                    }
-                }
-            }
-
-            // Так плохо писать, но код выполнится, только если разделение не произошло
-            attempt = max_attempts + 1;
-        }
-    }
-
-    // оптимизация перезаполнения
-    reinsertRoutine(intervals, N, L);
-
-    {
-        auto it = deferred.begin();
-        while (it != deferred.end()) {
-            bool result = tryReduceUser(intervals, user_data[*it], 0, deferred);
-            auto last_it = it;
-            ++it;
-            if (result) {
-                deferred.erase(last_it);
-            }
-        }
-    }
-
-    // Последняя попытка вставить
-    for (int i = 0; i < 10 * max_attempts; ++i) {
-
-        // довставить
-        bool success = false;
-        auto it = deferred.begin();
-        while (it != deferred.end()) {
-            bool result = tryReplaceUser(intervals, user_data[*it], 0, 10000, L, deferred, true);
-            auto last_it = it;
-            ++it;
-            if (result) {
-                success = true;
-                deferred.erase(last_it);
-            }
-        }
-        if (success) continue;
-
-        if (intervals.size() >= J || deferred.size() == 0) break;
-        float loss_threshold_multiplier = getLossThresholdMultiplier(N - (int)deferred.size(), N);
-
-        int split_index = findIntervalToSplit(intervals, user_data[*deferred.begin()], loss_threshold_multiplier, L);
-        if (split_index >= 0) {
-            splitRoutine(intervals, user_data[*deferred.begin()], split_index, loss_threshold_multiplier);
-            reinsertRoutine(intervals, N, L);
-        }
-        else {
-            deferred.erase(deferred.begin());
-        }
-    }
-
-    return move(intervals);
-}
\ No newline at end of file
+﻿#pragma once
+
+#pragma GCC optimize ("O3,function-inlining")
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <set>
+#include <unordered_set>
+#include <queue>
+#include <deque>
+#include <bitset>
+#include <random>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cinttypes>
+#include <utility>
+#include <cstdlib>
+#include <time.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits.h>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+
+// Векторные версии ядер собираются только под x86, выбор версии - getSolverIsa
+#if defined(__x86_64__) || defined(_M_X64)
+#define SOLVER_X86
+#include <immintrin.h>
+#endif
+// MSVC разрешает интринсики в любой функции, GCC и Clang - только с атрибутом target
+#if defined(SOLVER_X86) && defined(__GNUC__)
+#define SOLVER_TARGET_AVX2 __attribute__((target("avx2")))
+#define SOLVER_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SOLVER_TARGET_AVX2
+#define SOLVER_TARGET_AVX512
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+struct Interval {
+    int start, end;
+    vector<int> users;
+
+    Interval() : start(0), end(0) {}
+    Interval(int start, int end) : start(start), end(end) {}
+};
+
+
+struct UserInfo {
+    int rbNeed;
+    int beam;
+    int id;
+};
+
+// Номер пользователя в порядках обхода и множестве отложенных.
+// Не шире 16 бит: id лежит в младших 16 битах упакованных ключей сортировки
+typedef uint16_t UserId;
+
+//float loss_threshold_multiplier_A = -0.172f;
+//float loss_threshold_multiplier_B = 0.906f;
+//
+//int max_attempts = 3;
+
+// Параметры и состояние текущего вызова Solver - свои у каждого потока,
+// поэтому вызовы из разных потоков не мешают друг другу
+
+// В среднем на 0.002% лучше, лучший случай улучшился, худший немного ухудшился
+thread_local float loss_threshold_multiplier_A = -0.283f;
+thread_local float loss_threshold_multiplier_B = 0.972f;
+
+thread_local int max_attempts = 3;
+
+// минимальная длина свободной части отрезка чтобы произвошло разделение
+thread_local int last_split_attempt_threshold = 100;
+
+// минимальный общий префикс порядков, с которого прогон продолжается со снимка.
+// Копирование снимка дороже нескольких шагов жадного алгоритма, короткие префиксы не окупаются
+int min_checkpoint_prefix = 8;
+
+unordered_map<int, int> test_metrics;
+
+/// <summary>
+/// Освобождение thread_local состояния при завершении потока. Объекты с тривиальным деструктором
+/// (LocalArray, списки PoolAllocator) регистрируют здесь функцию освобождения при первом выделении,
+/// деструктор этого объекта вызывает их все
+/// </summary>
+struct ThreadStorage {
+    vector<pair<void*, void (*)(void*)>> releases;
+
+    void add(void* owner, void (*release)(void*)) {
+        releases.push_back({ owner, release });
+    }
+
+    ~ThreadStorage() {
+        for (auto& entry : releases) entry.second(entry.first);
+    }
+};
+
+thread_local ThreadStorage thread_storage;
+
+/// <summary>
+/// Растущий массив для thread_local состояния. Деструктор тривиальный, поэтому обращение
+/// к такой переменной не проверяет инициализацию в потоке, как для vector.
+/// Память освобождает thread_storage при завершении потока, поэтому LocalArray
+/// может быть только thread_local переменной или её частью
+/// </summary>
+template <typename T>
+struct LocalArray {
+    T* items = nullptr;
+    int count = 0;
+    int capacity = 0;
+    // массив записан в thread_storage, признак остаётся у объекта и при обмене
+    bool registered = false;
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    void reserve(int n) {
+        if (n <= capacity) return;
+        track();
+        T* grown = new T[n];
+        copy(items, items + count, grown);
+        delete[] items;
+        items = grown;
+        capacity = n;
+    }
+
+    // Новые элементы заполняются значением по умолчанию, как в vector
+    void resize(int n) {
+        reserve(n);
+        if (n > count) fill(items + count, items + n, T());
+        count = n;
+    }
+
+    void push_back(const T& value) {
+        if (count == capacity) reserve(max(8, 2 * capacity));
+        items[count++] = value;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    void assign(int n, const T& value) {
+        resize(n);
+        fill(items, items + n, value);
+    }
+
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        resize((int)(last - first));
+        copy(first, last, items);
+    }
+
+    void track() {
+        if (registered) return;
+        thread_storage.add(this, &LocalArray::release);
+        registered = true;
+    }
+
+    // Память переходит к другому объекту, поэтому записаны должны быть оба
+    friend void swap(LocalArray& l, LocalArray& r) {
+        l.track();
+        r.track();
+        std::swap(l.items, r.items);
+        std::swap(l.count, r.count);
+        std::swap(l.capacity, r.capacity);
+    }
+
+    static void release(void* owner) {
+        LocalArray* array = (LocalArray*)owner;
+        delete[] array->items;
+        array->items = nullptr;
+        array->count = 0;
+        array->capacity = 0;
+    }
+};
+
+/// <summary>
+/// Атрибуты пользователей отдельными массивами по id и упакованные ключи сортировок.
+/// Ключ сортируется по убыванию, в младших 16 битах лежит id
+/// </summary>
+struct UserTable {
+    LocalArray<int> rbNeed;
+    LocalArray<int> beam;
+    // rbNeed, beam, id - порядок обработки пользователей в realSolver
+    LocalArray<uint64_t> order_key;
+
+    void assign(const vector<UserInfo>& users) {
+        int n = (int)users.size();
+        rbNeed.resize(n);
+        beam.resize(n);
+        order_key.resize(n);
+        for (const auto& user : users) {
+            rbNeed[user.id] = user.rbNeed;
+            beam[user.id] = user.beam;
+            order_key[user.id] = ((uint64_t)user.rbNeed << 32) | ((uint64_t)user.beam << 16) | (uint64_t)user.id;
+        }
+    }
+
+    UserInfo get(int id) const {
+        return { rbNeed[id], beam[id], id };
+    }
+
+    // Ключ для множества отложенных пользователей: rbNeed и beam без id
+    uint64_t deferredKey(int id) const {
+        return order_key[id] >> 16;
+    }
+};
+
+thread_local UserTable user_table;
+
+// границы выданных пользователям блоков [first, second), -1 - пользователь не вставлен
+thread_local LocalArray<pair<int, int>> user_intervals;
+
+inline uint64_t packUserKey(uint64_t high, uint64_t middle, int id) {
+    return (high << 48) | (middle << 16) | (uint64_t)id;
+}
+
+// Сортирует ключи по убыванию и раскладывает id из младших 16 бит в ids
+inline void sortIdsByPackedKeys(vector<uint64_t>& keys, vector<UserId>& ids) {
+    sort(keys.begin(), keys.end(), greater<uint64_t>());
+    ids.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) ids[i] = (UserId)(keys[i] & 0xFFFF);
+}
+
+/// <summary>
+/// Параметры жадного алгоритма, которые подбираются под класс экземпляра
+/// </summary>
+struct SolverParams {
+    float loss_threshold_multiplier_A;
+    float loss_threshold_multiplier_B;
+    int max_attempts;
+    int last_split_attempt_threshold;
+};
+
+// Параметры для классов без записи в таблице и при выключенной таблице
+SolverParams default_solver_params = { loss_threshold_multiplier_A, loss_threshold_multiplier_B, max_attempts, last_split_attempt_threshold };
+
+inline void applySolverParams(const SolverParams& params) {
+    loss_threshold_multiplier_A = params.loss_threshold_multiplier_A;
+    loss_threshold_multiplier_B = params.loss_threshold_multiplier_B;
+    max_attempts = params.max_attempts;
+    last_split_attempt_threshold = params.last_split_attempt_threshold;
+}
+
+void setHyperParams(float a, float b) {
+    default_solver_params.loss_threshold_multiplier_A = a;
+    default_solver_params.loss_threshold_multiplier_B = b;
+    applySolverParams(default_solver_params);
+}
+
+void setMaxAttempts(int V) {
+    default_solver_params.max_attempts = V;
+    applySolverParams(default_solver_params);
+}
+
+void setLastSplitAttemptThreshold(int V) {
+    default_solver_params.last_split_attempt_threshold = V;
+    applySolverParams(default_solver_params);
+}
+
+// 0 - зерно от time(0) в каждом вызове Solver, иначе фиксированное зерно
+unsigned int solver_seed = 0;
+
+void setSolverSeed(unsigned int seed) {
+    solver_seed = seed;
+}
+
+inline unsigned int getSolverSeed() {
+    return solver_seed != 0 ? solver_seed : (unsigned int)time(0);
+}
+
+// Зерно экземпляра index пакета: не зависит от потока, который его решает; index 0 - зерно одиночного вызова
+inline unsigned int getInstanceSeed(unsigned int seed, int index) {
+    return seed + (unsigned int)index * 0x9E3779B9u;
+}
+
+unordered_map<int, int>& getTestMetrics() {
+    return test_metrics;
+}
+
+struct UserSetComparator {
+    bool operator()(int id1, int id2) const {
+        return user_table.deferredKey(id1) > user_table.deferredKey(id2);
+    }
+};
+
+/// <summary>
+/// Аллокатор узлов по одному из списка свободных блоков. Освобождённые узлы не возвращаются в кучу,
+/// поэтому после первых вызовов множества отложенных пользователей не выделяют память.
+/// Узел может освободиться в другом потоке (экземпляры BatchSolver), поэтому блоки не принадлежат
+/// потоку: излишек свободных узлов и все свободные узлы завершившегося потока переходят в общий запас,
+/// из которого берут потоки с пустым списком, и память не растёт с числом запущенных потоков
+/// </summary>
+template <typename T>
+struct PoolAllocator {
+    typedef T value_type;
+
+    // блоков в одном выделении из кучи
+    static const int CHUNK_NODES = 256;
+
+    // свободных узлов у потока не больше, чем вдвое больше этого числа, излишек уходит в общий запас
+    static const int LOCAL_NODES = 16 * CHUNK_NODES;
+
+    union Node {
+        Node* next;
+        alignas(T) char storage[sizeof(T)];
+    };
+
+    // Свободные узлы потока. released - список уже отдан в запас при завершении потока,
+    // узлы, освобождённые деструкторами позже, идут сразу в запас
+    struct FreeList {
+        Node* head;
+        int count;
+        bool registered;
+        bool released;
+    };
+
+    static FreeList& freeList() {
+        static thread_local FreeList list = { nullptr, 0, false, false };
+        return list;
+    }
+
+    static Node*& sharedList() {
+        static Node* head = nullptr;
+        return head;
+    }
+
+    static mutex& sharedLock() {
+        static mutex lock;
+        return lock;
+    }
+
+    // Первые keep узлов остаются потоку, остальные переходят в общий запас
+    static void spill(FreeList& list, int keep) {
+        Node* rest = list.head;
+        Node* last_kept = nullptr;
+        for (int i = 0; i < keep && rest != nullptr; ++i) {
+            last_kept = rest;
+            rest = rest->next;
+        }
+        if (rest == nullptr) return;
+        Node* tail = rest;
+        while (tail->next != nullptr) tail = tail->next;
+        if (last_kept != nullptr) last_kept->next = nullptr;
+        else list.head = nullptr;
+        list.count = keep;
+
+        lock_guard<mutex> lock(sharedLock());
+        tail->next = sharedList();
+        sharedList() = rest;
+    }
+
+    static void releaseFreeList(void*) {
+        FreeList& list = freeList();
+        spill(list, 0);
+        list.released = true;
+    }
+
+    PoolAllocator() {}
+    template <typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if (n != 1) return (T*)::operator new(n * sizeof(T));
+        FreeList& list = freeList();
+        if (list.head == nullptr) {
+            if (!list.registered) {
+                thread_storage.add(nullptr, &PoolAllocator::releaseFreeList);
+                list.registered = true;
+            }
+            {
+                lock_guard<mutex> lock(sharedLock());
+                list.head = sharedList();
+                sharedList() = nullptr;
+            }
+            list.count = 0;
+            for (Node* node = list.head; node != nullptr; node = node->next) ++list.count;
+            if (list.count > 2 * LOCAL_NODES) spill(list, LOCAL_NODES);
+        }
+        if (list.head == nullptr) {
+            Node* chunk = (Node*)::operator new(CHUNK_NODES * sizeof(Node));
+            for (int i = 0; i < CHUNK_NODES; ++i) {
+                chunk[i].next = list.head;
+                list.head = &chunk[i];
+            }
+            list.count = CHUNK_NODES;
+        }
+        Node* node = list.head;
+        list.head = node->next;
+        --list.count;
+        return (T*)node;
+    }
+
+    // Узлы, освобождённые в чужом потоке, копятся у него, поэтому излишек возвращается в запас
+    void deallocate(T* pointer, size_t n) {
+        if (n != 1) {
+            ::operator delete(pointer);
+            return;
+        }
+        Node* node = (Node*)pointer;
+        FreeList& list = freeList();
+        if (list.released) {
+            lock_guard<mutex> lock(sharedLock());
+            node->next = sharedList();
+            sharedList() = node;
+            return;
+        }
+        node->next = list.head;
+        list.head = node;
+        if (++list.count >= 2 * LOCAL_NODES) spill(list, LOCAL_NODES);
+    }
+
+    template <typename U> bool operator==(const PoolAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+typedef set<UserId, UserSetComparator, PoolAllocator<UserId>> DeferredSet;
+
+// Результат шага, изменяющего расписание. Ошибка прерывает текущий прогон realSolver
+enum StepStatus {
+    STEP_FAILED = -1,
+    STEP_SKIPPED = 0,
+    STEP_DONE = 1
+};
+
+// Нарушение инварианта расписания: в режиме проверки инвариантов останавливает программу,
+// иначе возвращает false и прогон отбрасывается
+inline bool reportSolverError(const char* message) {
+#ifdef SOLVER_CHECK_INVARIANTS
+    cerr << "Solver invariant violated: " << message << endl;
+    abort();
+#else
+    (void)message;
+#endif
+    return false;
+}
+
+// Сбрасывают векторное представление интервалов: одну строку или целиком при изменении порядка интервалов
+inline void invalidateIntervalsView(int row);
+inline void invalidateIntervalsLayout();
+
+/// <summary>
+/// Пользователи интервала без выделения памяти. У пользователей одного интервала разные beam,
+/// поэтому их не больше 32. Повторяет нужную часть интерфейса vector
+/// </summary>
+struct IntervalUsers {
+    static const int CAPACITY = 32;
+
+    int count = 0;
+    UserId ids[CAPACITY];
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    UserId& operator[](int i) { return ids[i]; }
+    UserId operator[](int i) const { return ids[i]; }
+    UserId back() const { return ids[count - 1]; }
+    UserId* begin() { return ids; }
+    UserId* end() { return ids + count; }
+    const UserId* begin() const { return ids; }
+    const UserId* end() const { return ids + count; }
+
+    void push_back(int id) {
+        ids[count++] = (UserId)id;
+    }
+
+    void insert(UserId* position, int id) {
+        for (UserId* it = end(); it != position; --it) *it = *(it - 1);
+        *position = (UserId)id;
+        ++count;
+    }
+
+    void erase(UserId* position) {
+        for (UserId* it = position + 1; it != end(); ++it) *(it - 1) = *it;
+        --count;
+    }
+
+    bool operator==(const IntervalUsers& other) const {
+        return count == other.count && equal(begin(), end(), other.begin());
+    }
+};
+
+/// <summary>
+/// Интервал расписания. Не содержит указателей на кучу, поэтому копирование снимков
+/// и результатов не выделяет память
+/// </summary>
+struct MaskedInterval {
+    int start, end;
+    IntervalUsers users;
+
+    unsigned int mask = 0;
+    int mask_indices[32];
+
+    // Номер строки интервала в IntervalsSoA
+    int view_row = -1;
+
+    MaskedInterval(int start, int end) : start(start), end(end) {}
+
+    int getLength() const {
+        return end - start;
+    }
+
+    bool hasMaskCollision(const UserInfo& user) const {
+        return (mask & (1 << user.beam)) != 0;
+    }
+
+    int getMaxLoss() const {
+        return max(0, end - user_intervals[users.back()].second);
+    }
+
+    void eraseUser(int user_id) {
+        if (!hasMaskCollision(user_table.get(user_id))) return;
+
+        int beam = user_table.beam[user_id];
+        int index = mask_indices[beam];
+        if (users[index] != user_id) return;
+        mask ^= (1 << beam);
+        users.erase(users.begin() + index);
+        for (int i = 0; i < users.size(); ++i) mask_indices[user_table.beam[users[i]]] = i;
+        invalidateIntervalsView(view_row);
+    }
+
+    bool insertSplitUser(const UserInfo& user) {
+        if (user_intervals[user.id].first == -1) {
+            return reportSolverError("insertSplitUser: user_intervals[user.id].first == -1");
+        }
+
+        users.push_back(user.id);
+        mask |= (1 << user.beam);
+        mask_indices[user.beam] = users.size() - 1;
+        invalidateIntervalsView(view_row);
+        return true;
+    }
+
+    bool insertNewUser(const UserInfo& user) {
+        if (user_intervals[user.id].first != -1) {
+            return reportSolverError("insertNewUser: user_intervals[user.id].first != -1");
+        }
+
+        // Вставка с сортировкой
+        int i = 0;
+        for (; i < users.size(); ++i) {
+            int new_user_bound = start + user.rbNeed;
+            int old_user_bound = user_intervals[users[i]].second;
+            if (new_user_bound >= old_user_bound) {
+                break;
+            }
+        }
+
+        if (i == users.size()) {
+            users.push_back(user.id);
+        }
+        else {
+            users.insert(users.begin() + i, user.id);
+        }
+
+
+        user_intervals[user.id] = { start, min(end, start + user.rbNeed) };
+
+        mask |= (1 << user.beam);
+        for (int i = 0; i < users.size(); ++i) mask_indices[user_table.beam[users[i]]] = i;
+        invalidateIntervalsView(view_row);
+        return true;
+    }
+
+    bool canBeDeferred(int user_index) const {
+        int user_id = users[user_index];
+        return user_intervals[user_id].first == start && user_intervals[user_id].second <= end;
+    }
+
+    /// <summary>
+    /// Заменяет пользователя на позиции index новым, в deferred_index записывается вытесненный
+    /// пользователь, которого можно отложить, или -1
+    /// </summary>
+    bool replaceUser(const UserInfo& user, int index, int& deferred_index) {
+
+        deferred_index = -1;
+        if (index < users.size()) {
+            if (canBeDeferred(index)) {
+                deferred_index = users[index];
+            }
+
+            int user_id = users[index];
+            if (user_intervals[user_id].second > end) {
+                return reportSolverError("replaceUser: user_intervals[user_id].second > end");
+            }
+
+            if (user_intervals[user_id].first < start) {
+                user_intervals[user_id].second = start; // Оставили только левую часть
+                invalidateIntervalsLayout(); // левая часть лежит в других интервалах
+            }
+            else {
+                user_intervals[user_id] = { -1, -1 }; // Пользователь удален полностью
+            }
+
+            mask_indices[user_table.beam[user_id]] = -1;
+            mask ^= (1 << user_table.beam[user_id]);
+            users.erase(users.begin() + index);
+        }
+
+        return insertNewUser(user);
+    }
+
+    pair<int, int> getInsertionProfit(const UserInfo& user, int L) const {
+
+        if (hasMaskCollision(user)) {
+            int index = mask_indices[user.beam];
+            int user_id = users[index];
+            return { min(end, start + user.rbNeed) - min(end, user_intervals[user_id].second), index };
+        }
+
+        if (users.size() < L) {
+            return { min(end - start, user.rbNeed), users.size() };
+        }
+
+        int index = (int)users.size() - 1;
+        int profit = min(end, start + user.rbNeed) - min(end, user_intervals[users.back()].second);
+
+        return { profit, index };
+    }
+
+    pair<int, int> getReduceProfit(const UserInfo& user) const {
+
+        if (user.rbNeed < getLength()) return { -1, -1 };
+
+        if (hasMaskCollision(user)) {
+            int index = mask_indices[user.beam];
+            int user_id = users[index];
+            int old_user_bound = user_intervals[user_id].first + user_table.rbNeed[user_id];
+            int new_user_bound = start + user.rbNeed;
+            if (old_user_bound <= end || !canBeDeferred(index)) return { -1, -1 };
+            return { max(0, old_user_bound - new_user_bound), index };
+        }
+
+        for (int i = 0; i < users.size(); ++i) {
+            int user_id = users[i];
+            int old_user_bound = user_intervals[user_id].first + user_table.rbNeed[user_id];
+            int new_user_bound = start + user.rbNeed;
+            if (old_user_bound <= end) break;
+            if (canBeDeferred(i)) {
+                return { max(0, old_user_bound - new_user_bound), i };
+            }
+        }
+
+        return { -1, -1 };
+    }
+};
+
+/// <summary>
+/// Отметка, что замена отложенного пользователя с этими порогами ничего не давала:
+/// ни один интервал раскладки epoch не превышал порог после первых changes записей журнала строк
+/// </summary>
+struct ReplaceMemo {
+    unsigned int epoch;
+    int changes;
+    int replace_threshold;
+    int overfill_threshold;
+};
+
+// Отметки по id пользователя, раскладки нумеруются с 1, поэтому нулевая отметка не действует
+thread_local LocalArray<ReplaceMemo> replace_memo;
+
+// Переносимые битовые операции над словами: MSVC не знает __builtin_*
+inline int popCount64(uint64_t value) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(value);
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+// Номер младшего единичного бита, value != 0
+inline int lowestBit64(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// Номер старшего единичного бита, value != 0
+inline int highestBit64(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+/// <summary>
+/// Набор инструкций ядер IntervalsSoA. Все версии собираются в один бинарник,
+/// нужная выбирается при запуске по CPUID, результаты у всех версий совпадают
+/// </summary>
+enum SolverIsa {
+    ISA_SCALAR,
+    ISA_AVX2,
+    ISA_AVX512,
+    ISA_COUNT
+};
+
+inline const char* getSolverIsaName(SolverIsa isa) {
+    switch (isa) {
+    case ISA_AVX2: return "avx2";
+    case ISA_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// Поддерживают ли версию процессор и ОС: AVX-регистры должны сохраняться при переключении потоков
+inline bool isSolverIsaSupported(SolverIsa isa) {
+    if (isa == ISA_SCALAR) return true;
+#if defined(SOLVER_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] >> 27) & 1;
+    bool avx = (info[2] >> 28) & 1;
+    if (!osxsave || !avx) return false;
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (isa == ISA_AVX2) return (xcr0 & 0x6) == 0x6 && ((info[1] >> 5) & 1);
+    if (isa == ISA_AVX512) return (xcr0 & 0xE6) == 0xE6 && ((info[1] >> 16) & 1);
+    return false;
+#elif defined(SOLVER_X86)
+    __builtin_cpu_init();
+    if (isa == ISA_AVX2) return __builtin_cpu_supports("avx2");
+    if (isa == ISA_AVX512) return __builtin_cpu_supports("avx512f");
+    return false;
+#else
+    return false;
+#endif
+}
+
+inline SolverIsa detectSolverIsa() {
+    for (int isa = ISA_COUNT - 1; isa > ISA_SCALAR; --isa) {
+        if (isSolverIsaSupported((SolverIsa)isa)) return (SolverIsa)isa;
+    }
+    return ISA_SCALAR;
+}
+
+SolverIsa solver_isa = detectSolverIsa();
+
+/// <summary>
+/// Принудительный выбор версии ядер, для сравнения версий между собой.
+/// Неподдерживаемая версия не выбирается, тогда возвращается false
+/// </summary>
+inline bool setSolverIsa(SolverIsa isa) {
+    if (isa < ISA_SCALAR || isa >= ISA_COUNT || !isSolverIsaSupported(isa)) return false;
+    solver_isa = isa;
+    return true;
+}
+
+inline SolverIsa getSolverIsa() {
+    return solver_isa;
+}
+
+/// <summary>
+/// Представление интервалов в виде структуры массивов для векторной оценки по 8 или 16 интервалов за инструкцию.
+/// Строится лениво из vector<MaskedInterval>: после изменения интервала перечитывается только его строка,
+/// после разделения и сортировки - всё представление. Границы пользователей нужны только
+/// tryReplaceUser и tryReduceUser, потери для разделения - только findIntervalToSplit,
+/// поэтому те и другие перечитываются отдельно и только по запросу. Потери для разделения
+/// переживают сортировку: неизменённый интервал забирает их из своей прежней строки
+/// </summary>
+struct IntervalsSoA {
+    // Строки дополняются до кратного LANES, чтобы любая версия ядер читала целые векторы
+    static const int AVX2_LANES = 8;
+    static const int AVX512_LANES = 16;
+    static const int LANES = AVX512_LANES;
+    static const int MAX_BEAMS = 32;
+
+    bool layout_valid = false;
+    int count = 0;
+    int padded = 0;
+
+    LocalArray<int> start, end, size, mask;
+    // Граница последнего пользователя, для пустого интервала - конец интервала
+    LocalArray<int> last_bound;
+    // Граница первого пользователя, которого можно отложить в getReduceProfit, INT_MIN если такого нет
+    LocalArray<int> reduce_bound;
+    // То же для пользователя с конкретным лучом, индекс [beam * padded + i]
+    LocalArray<int> beam_bound;
+    LocalArray<int> beam_reduce_bound;
+    // Вес позиции интервала в tryReplaceUser: 1 - (i / count)^8
+    LocalArray<float> position_coef;
+    // Для поиска разделения: граница k-го пользователя интервала и его потеря до конца интервала,
+    // индекс [i * IntervalUsers::CAPACITY + k], и признак актуальности строки
+    LocalArray<int> split_bound;
+    LocalArray<int> split_loss;
+    LocalArray<char> split_fresh;
+    // Те же массивы прежней раскладки, из них потери переносятся после сортировки
+    LocalArray<int> moved_split_bound;
+    LocalArray<int> moved_split_loss;
+    LocalArray<char> moved_split_fresh;
+    // Раскладка сброшена только перестановкой и добавлением интервалов
+    bool splits_movable = false;
+
+    // Строки с устаревшей геометрией, строки с устаревшими границами пользователей
+    // и с устаревшими потерями для разделения
+    LocalArray<int> dirty_rows;
+    LocalArray<int> stale_bounds;
+    LocalArray<int> stale_splits;
+
+    // Номер раскладки и журнал строк, изменённых после её построения, для ReplaceMemo
+    unsigned int layout_epoch = 0;
+    LocalArray<int> changed_rows;
+
+    // Строка индексируется прежней раскладкой, пока представление не перестроено
+    void markDirty(int row) {
+        if (row < 0 || row >= count) return;
+        if (split_fresh[row]) {
+            split_fresh[row] = 0;
+            stale_splits.push_back(row);
+        }
+        if (layout_valid) {
+            dirty_rows.push_back(row);
+            changed_rows.push_back(row);
+        }
+    }
+
+    void load(vector<MaskedInterval>& intervals, bool with_bounds) {
+        if (!layout_valid || count != (int)intervals.size()) {
+            int old_count = count;
+            count = (int)intervals.size();
+            bool move_splits = splits_movable;
+            if (move_splits) {
+                swap(split_bound, moved_split_bound);
+                swap(split_loss, moved_split_loss);
+                swap(split_fresh, moved_split_fresh);
+            }
+
+            if (padded != (count + LANES - 1) / LANES * LANES) {
+                padded = (count + LANES - 1) / LANES * LANES;
+                start.resize(padded);
+                end.resize(padded);
+                size.resize(padded);
+                mask.resize(padded);
+                last_bound.resize(padded);
+                reduce_bound.resize(padded);
+                position_coef.resize(padded);
+                beam_bound.resize(MAX_BEAMS * padded);
+                beam_reduce_bound.resize(MAX_BEAMS * padded);
+            }
+            split_bound.resize(IntervalUsers::CAPACITY * padded);
+            split_loss.resize(IntervalUsers::CAPACITY * padded);
+            split_fresh.resize(padded);
+
+            stale_bounds.clear();
+            stale_splits.clear();
+            for (int i = 0; i < count; ++i) {
+                float x = (float)i / count;
+                x *= x;
+                x *= x;
+                x *= x;
+                position_coef[i] = 1.0f + -x;
+                int old_row = intervals[i].view_row;
+                loadRow(intervals[i], i);
+                stale_bounds.push_back(i);
+
+                if (move_splits && old_row >= 0 && old_row < old_count && moved_split_fresh[old_row]) {
+                    copy_n(&moved_split_bound[old_row * IntervalUsers::CAPACITY], size[i], &split_bound[i * IntervalUsers::CAPACITY]);
+                    copy_n(&moved_split_loss[old_row * IntervalUsers::CAPACITY], size[i], &split_loss[i * IntervalUsers::CAPACITY]);
+                    split_fresh[i] = 1;
+                }
+                else {
+                    split_fresh[i] = 0;
+                    stale_splits.push_back(i);
+                }
+            }
+
+            // Хвост до кратного LANES заполняется пустыми интервалами, ядра их отбрасывают
+            for (int i = count; i < padded; ++i) {
+                start[i] = end[i] = size[i] = mask[i] = last_bound[i] = 0;
+                reduce_bound[i] = INT_MIN;
+                position_coef[i] = 0.0f;
+            }
+
+            dirty_rows.clear();
+            changed_rows.clear();
+            ++layout_epoch;
+            layout_valid = true;
+            splits_movable = false;
+        }
+        else if (!dirty_rows.empty()) {
+            for (int row : dirty_rows) {
+                loadRow(intervals[row], row);
+                stale_bounds.push_back(row);
+            }
+            dirty_rows.clear();
+        }
+
+        if (with_bounds) {
+            for (int row : stale_bounds) loadBounds(intervals[row], row);
+            stale_bounds.clear();
+        }
+    }
+
+    void loadStaleSplits(const vector<MaskedInterval>& intervals) {
+        for (int row : stale_splits) {
+            loadSplits(intervals[row], row);
+            split_fresh[row] = 1;
+        }
+        stale_splits.clear();
+    }
+
+    void loadRow(MaskedInterval& interval, int i) {
+        start[i] = interval.start;
+        end[i] = interval.end;
+        size[i] = (int)interval.users.size();
+        mask[i] = (int)interval.mask;
+        last_bound[i] = interval.users.empty() ? interval.end : user_intervals[interval.users.back()].second;
+        interval.view_row = i;
+    }
+
+    void loadSplits(const MaskedInterval& interval, int i) {
+        int* split_bounds = &split_bound[i * IntervalUsers::CAPACITY];
+        int* split_losses = &split_loss[i * IntervalUsers::CAPACITY];
+        for (int k = 0; k < interval.users.size(); ++k) {
+            split_bounds[k] = user_intervals[interval.users[k]].second;
+            split_losses[k] = interval.end - min(interval.end, split_bounds[k]);
+        }
+    }
+
+    void loadBounds(const MaskedInterval& interval, int i) {
+        reduce_bound[i] = INT_MIN;
+
+        bool reduce_found = false;
+        for (int k = 0; k < interval.users.size(); ++k) {
+            int user_id = interval.users[k];
+            int beam = user_table.beam[user_id];
+            int old_user_bound = user_intervals[user_id].first + user_table.rbNeed[user_id];
+            bool deferrable = interval.canBeDeferred(k);
+
+            beam_bound[beam * padded + i] = user_intervals[user_id].second;
+            beam_reduce_bound[beam * padded + i] = (old_user_bound > interval.end && deferrable) ? old_user_bound : INT_MIN;
+
+            if (!reduce_found) {
+                if (old_user_bound <= interval.end) reduce_found = true;
+                else if (deferrable) {
+                    reduce_bound[i] = old_user_bound;
+                    reduce_found = true;
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Лучший интервал для tryReplaceUser: максимум getInsertionProfit с весом 1 - x^8,
+    /// при равенстве берётся последний. Возвращает -1 если подходящих интервалов нет
+    /// </summary>
+    int findBestReplace(const UserInfo& user, int replace_threshold, int overfill_threshold, int L, float& best_profit) const {
+        switch (solver_isa) {
+#if defined(SOLVER_X86)
+        case ISA_AVX512: return findBestReplaceAvx512(user, replace_threshold, overfill_threshold, L, best_profit);
+        case ISA_AVX2: return findBestReplaceAvx2(user, replace_threshold, overfill_threshold, L, best_profit);
+#endif
+        default: return findBestReplaceScalar(user, replace_threshold, overfill_threshold, L, best_profit);
+        }
+    }
+
+    int findBestReplaceScalar(const UserInfo& user, int replace_threshold, int overfill_threshold, int L, float& best_profit) const {
+        int best_index = -1;
+        best_profit = 0;
+        for (int i = 0; i < count; ++i) {
+            float score = getReplaceScore(user, i, replace_threshold, overfill_threshold, L);
+            if (score >= best_profit) {
+                best_profit = score;
+                best_index = i;
+            }
+        }
+        return best_index;
+    }
+
+    // Одна строка findBestReplace, -1 если интервал пропускается
+    float getReplaceScore(const UserInfo& user, int i, int replace_threshold, int overfill_threshold, int L) const {
+        int new_bound = start[i] + user.rbNeed;
+        int length = end[i] - start[i];
+        if (size[i] == L && (max(0, end[i] - last_bound[i]) <= replace_threshold || last_bound[i] > new_bound)) return -1.0f;
+        if (user.rbNeed - length > overfill_threshold) return -1.0f;
+
+        int profit;
+        if (mask[i] & (1 << user.beam)) profit = min(end[i], new_bound) - min(end[i], beam_bound[user.beam * padded + i]);
+        else if (size[i] < L) profit = min(length, user.rbNeed);
+        else profit = min(end[i], new_bound) - min(end[i], last_bound[i]);
+
+        return profit * position_coef[i];
+    }
+
+    /// <summary>
+    /// Может ли замена, невыгодная на момент memo, стать выгодной. Невыгодна она была во всех строках,
+    /// поэтому пересчитываются только строки, изменённые с тех пор, а после перестройки раскладки - все
+    /// </summary>
+    bool replaceMayProfit(const ReplaceMemo& memo, const UserInfo& user, int replace_threshold, int overfill_threshold, int L) const {
+        if (memo.epoch != layout_epoch || memo.replace_threshold != replace_threshold || memo.overfill_threshold != overfill_threshold) return true;
+        if (changed_rows.size() - memo.changes > count) return true;
+        for (int k = memo.changes; k < changed_rows.size(); ++k) {
+            if (getReplaceScore(user, changed_rows[k], replace_threshold, overfill_threshold, L) > replace_threshold) return true;
+        }
+        return false;
+    }
+
+    ReplaceMemo makeReplaceMemo(int replace_threshold, int overfill_threshold) const {
+        return { layout_epoch, changed_rows.size(), replace_threshold, overfill_threshold };
+    }
+
+    /// <summary>
+    /// Интервал для разделения под пользователя, как getSplitPositionAndIndex по всем интервалам:
+    /// наименьший индекс разделения, при равенстве наибольшая выгода вставки, затем первый.
+    /// Потери пользователей берутся из строк, перечитанных после изменения интервала,
+    /// выгода вставки считается только для интервалов, которые могут победить
+    /// </summary>
+    int findSplit(const vector<MaskedInterval>& intervals, const UserInfo& user, float loss_threshold_multiplier, int L) const {
+        float loss_threshold = user.rbNeed * loss_threshold_multiplier;
+        int min_position = INT_MAX;
+        int max_profit = 0;
+        int optimal_index = -1;
+        for (int i = 0; i < count; ++i) {
+            if (end[i] - start[i] < 2) continue;
+
+            // getSplitIndex
+            const int* split_losses = &split_loss[i * IntervalUsers::CAPACITY];
+            int users_count = size[i];
+            int position = 0;
+            while (position < users_count && !(split_losses[position] > loss_threshold)) ++position;
+            if (position == users_count && users_count > 0 && split_losses[users_count - 1] > last_split_attempt_threshold) --position;
+            if (position == users_count || position > min_position) continue;
+
+            int middle_position = split_bound[i * IntervalUsers::CAPACITY + position];
+            if (middle_position <= start[i] || middle_position >= end[i]) continue;
+
+            int profit = intervals[i].getInsertionProfit(user, L).first;
+            if (position < min_position || profit > max_profit) {
+                min_position = position;
+                max_profit = profit;
+                optimal_index = i;
+            }
+        }
+        return optimal_index;
+    }
+
+    /// <summary>
+    /// Лучший интервал для tryReduceUser: первый максимум getReduceProfit,
+    /// возвращает -1 если сокращение ничего не даёт
+    /// </summary>
+    int findBestReduce(const UserInfo& user, int& best_profit) const {
+        switch (solver_isa) {
+#if defined(SOLVER_X86)
+        case ISA_AVX512: return findBestReduceAvx512(user, best_profit);
+        case ISA_AVX2: return findBestReduceAvx2(user, best_profit);
+#endif
+        default: return findBestReduceScalar(user, best_profit);
+        }
+    }
+
+    int findBestReduceScalar(const UserInfo& user, int& best_profit) const {
+        const int* beam_bounds = &beam_reduce_bound[user.beam * padded];
+        int best_index = -1;
+        best_profit = 0;
+        for (int i = 0; i < count; ++i) {
+            int old_bound = (mask[i] & (1 << user.beam)) ? beam_bounds[i] : reduce_bound[i];
+            if (old_bound == INT_MIN || user.rbNeed < end[i] - start[i]) continue;
+
+            int profit = max(0, old_bound - (start[i] + user.rbNeed));
+            if (profit > best_profit) {
+                best_profit = profit;
+                best_index = i;
+            }
+        }
+        return best_index;
+    }
+
+    /// <summary>
+    /// Интервал для findInsertIndex: среди интервалов не короче пользователя и без коллизии луча
+    /// последний с минимальным количеством пользователей, не больше L - 1
+    /// </summary>
+    int findInsert(const UserInfo& user, int L) const {
+        switch (solver_isa) {
+#if defined(SOLVER_X86)
+        case ISA_AVX512: return findInsertAvx512(user, L);
+        case ISA_AVX2: return findInsertAvx2(user, L);
+#endif
+        default: return findInsertScalar(user, L);
+        }
+    }
+
+    int findInsertScalar(const UserInfo& user, int L) const {
+        int first_or_shortest = -1;
+        int min_filled = L - 1;
+        for (int i = 0; i < count; ++i) {
+            if (end[i] - start[i] < user.rbNeed) break;
+            if (mask[i] & (1 << user.beam)) continue;
+
+            if (size[i] <= min_filled) {
+                first_or_shortest = i;
+                min_filled = size[i];
+            }
+        }
+        return first_or_shortest;
+    }
+
+#if defined(SOLVER_X86)
+// В GCC 12 _mm512_min/max_epi32 и _mm512_reduce_* передают неопределённый вектор как сквозное значение
+// маскированной версии, и -Wall выдаёт на каждое ядро -Wmaybe-uninitialized из avx512fintrin.h
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    SOLVER_TARGET_AVX2 int findBestReplaceAvx2(const UserInfo& user, int replace_threshold, int overfill_threshold, int L, float& best_profit) const {
+        const int* beam_bounds = &beam_bound[user.beam * padded];
+        int best_index = -1;
+        best_profit = 0;
+
+        const __m256i vL = _mm256_set1_epi32(L);
+        const __m256i vRb = _mm256_set1_epi32(user.rbNeed);
+        const __m256i vReplace = _mm256_set1_epi32(replace_threshold);
+        const __m256i vOverfill = _mm256_set1_epi32(overfill_threshold);
+        const __m256i vBeam = _mm256_set1_epi32(1 << user.beam);
+        const __m256i vLast = _mm256_set1_epi32(count - 1);
+        const __m256i vZero = _mm256_setzero_si256();
+        const __m256i vOnes = _mm256_set1_epi32(-1);
+        const __m256 vSkip = _mm256_set1_ps(-1.0f);
+        __m256i vIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        for (int i = 0; i < padded; i += AVX2_LANES) {
+            __m256i s = _mm256_loadu_si256((const __m256i*)&start[i]);
+            __m256i e = _mm256_loadu_si256((const __m256i*)&end[i]);
+            __m256i sz = _mm256_loadu_si256((const __m256i*)&size[i]);
+            __m256i m = _mm256_loadu_si256((const __m256i*)&mask[i]);
+            __m256i lb = _mm256_loadu_si256((const __m256i*)&last_bound[i]);
+            __m256i bb = _mm256_loadu_si256((const __m256i*)&beam_bounds[i]);
+
+            __m256i len = _mm256_sub_epi32(e, s);
+            __m256i new_bound = _mm256_add_epi32(s, vRb);
+            __m256i new_bound_clamped = _mm256_min_epi32(e, new_bound);
+
+            // Заполненный интервал пропускается если потери малы или последний пользователь длиннее нового
+            __m256i full = _mm256_cmpeq_epi32(sz, vL);
+            __m256i max_loss = _mm256_max_epi32(vZero, _mm256_sub_epi32(e, lb));
+            __m256i small_loss = _mm256_andnot_si256(_mm256_cmpgt_epi32(max_loss, vReplace), vOnes);
+            __m256i skip = _mm256_and_si256(full, _mm256_or_si256(small_loss, _mm256_cmpgt_epi32(lb, new_bound)));
+            skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(_mm256_sub_epi32(vRb, len), vOverfill));
+            skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(vIndex, vLast));
+
+            // getInsertionProfit
+            __m256i collision = _mm256_cmpeq_epi32(_mm256_and_si256(m, vBeam), vBeam);
+            __m256i not_full = _mm256_cmpgt_epi32(vL, sz);
+            __m256i profit_last = _mm256_sub_epi32(new_bound_clamped, _mm256_min_epi32(e, lb));
+            __m256i profit_free = _mm256_min_epi32(len, vRb);
+            __m256i profit_collision = _mm256_sub_epi32(new_bound_clamped, _mm256_min_epi32(e, bb));
+            __m256i profit = _mm256_blendv_epi8(profit_last, profit_free, not_full);
+            profit = _mm256_blendv_epi8(profit, profit_collision, collision);
+
+            __m256 coef = _mm256_loadu_ps(&position_coef[i]);
+            __m256 score = _mm256_mul_ps(_mm256_cvtepi32_ps(profit), coef);
+            score = _mm256_blendv_ps(score, vSkip, _mm256_castsi256_ps(skip));
+
+            __m256 block_max = horizontalMax(score);
+            float block_best = _mm256_cvtss_f32(block_max);
+            if (block_best >= best_profit) {
+                int lanes = _mm256_movemask_ps(_mm256_cmp_ps(score, block_max, _CMP_EQ_OQ));
+                best_index = i + highestBit64((unsigned int)lanes);
+                best_profit = block_best;
+            }
+
+            vIndex = _mm256_add_epi32(vIndex, _mm256_set1_epi32(AVX2_LANES));
+        }
+        return best_index;
+    }
+
+    // Те же шаги, что в findBestReplaceAvx2, условия собираются в маски __mmask16
+    SOLVER_TARGET_AVX512 int findBestReplaceAvx512(const UserInfo& user, int replace_threshold, int overfill_threshold, int L, float& best_profit) const {
+        const int* beam_bounds = &beam_bound[user.beam * padded];
+        int best_index = -1;
+        best_profit = 0;
+
+        const __m512i vL = _mm512_set1_epi32(L);
+        const __m512i vRb = _mm512_set1_epi32(user.rbNeed);
+        const __m512i vReplace = _mm512_set1_epi32(replace_threshold);
+        const __m512i vOverfill = _mm512_set1_epi32(overfill_threshold);
+        const __m512i vBeam = _mm512_set1_epi32(1 << user.beam);
+        const __m512i vLast = _mm512_set1_epi32(count - 1);
+        const __m512i vZero = _mm512_setzero_si512();
+        const __m512 vSkip = _mm512_set1_ps(-1.0f);
+        __m512i vIndex = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (int i = 0; i < padded; i += AVX512_LANES) {
+            __m512i s = _mm512_loadu_si512(&start[i]);
+            __m512i e = _mm512_loadu_si512(&end[i]);
+            __m512i sz = _mm512_loadu_si512(&size[i]);
+            __m512i m = _mm512_loadu_si512(&mask[i]);
+            __m512i lb = _mm512_loadu_si512(&last_bound[i]);
+            __m512i bb = _mm512_loadu_si512(&beam_bounds[i]);
+
+            __m512i len = _mm512_sub_epi32(e, s);
+            __m512i new_bound = _mm512_add_epi32(s, vRb);
+            __m512i new_bound_clamped = _mm512_min_epi32(e, new_bound);
+
+            __mmask16 full = _mm512_cmpeq_epi32_mask(sz, vL);
+            __m512i max_loss = _mm512_max_epi32(vZero, _mm512_sub_epi32(e, lb));
+            __mmask16 small_loss = _mm512_cmple_epi32_mask(max_loss, vReplace);
+            __mmask16 skip = full & (small_loss | _mm512_cmpgt_epi32_mask(lb, new_bound));
+            skip |= _mm512_cmpgt_epi32_mask(_mm512_sub_epi32(vRb, len), vOverfill);
+            skip |= _mm512_cmpgt_epi32_mask(vIndex, vLast);
+
+            __mmask16 collision = _mm512_test_epi32_mask(m, vBeam);
+            __mmask16 not_full = _mm512_cmpgt_epi32_mask(vL, sz);
+            __m512i profit_last = _mm512_sub_epi32(new_bound_clamped, _mm512_min_epi32(e, lb));
+            __m512i profit_free = _mm512_min_epi32(len, vRb);
+            __m512i profit_collision = _mm512_sub_epi32(new_bound_clamped, _mm512_min_epi32(e, bb));
+            __m512i profit = _mm512_mask_blend_epi32(not_full, profit_last, profit_free);
+            profit = _mm512_mask_blend_epi32(collision, profit, profit_collision);
+
+            __m512 coef = _mm512_loadu_ps(&position_coef[i]);
+            __m512 score = _mm512_mul_ps(_mm512_cvtepi32_ps(profit), coef);
+            score = _mm512_mask_blend_ps(skip, score, vSkip);
+
+            float block_best = _mm512_reduce_max_ps(score);
+            if (block_best >= best_profit) {
+                __mmask16 lanes = _mm512_cmp_ps_mask(score, _mm512_set1_ps(block_best), _CMP_EQ_OQ);
+                best_index = i + highestBit64(lanes);
+                best_profit = block_best;
+            }
+
+            vIndex = _mm512_add_epi32(vIndex, _mm512_set1_epi32(AVX512_LANES));
+        }
+        return best_index;
+    }
+
+    SOLVER_TARGET_AVX2 int findBestReduceAvx2(const UserInfo& user, int& best_profit) const {
+        const int* beam_bounds = &beam_reduce_bound[user.beam * padded];
+        int best_index = -1;
+        best_profit = 0;
+
+        const __m256i vRb = _mm256_set1_epi32(user.rbNeed);
+        const __m256i vBeam = _mm256_set1_epi32(1 << user.beam);
+        const __m256i vInvalid = _mm256_set1_epi32(INT_MIN);
+        const __m256i vMinusOne = _mm256_set1_epi32(-1);
+        const __m256i vZero = _mm256_setzero_si256();
+
+        // Хвостовые интервалы имеют reduce_bound == INT_MIN и отбрасываются сами
+        for (int i = 0; i < padded; i += AVX2_LANES) {
+            __m256i s = _mm256_loadu_si256((const __m256i*)&start[i]);
+            __m256i e = _mm256_loadu_si256((const __m256i*)&end[i]);
+            __m256i m = _mm256_loadu_si256((const __m256i*)&mask[i]);
+            __m256i rb = _mm256_loadu_si256((const __m256i*)&reduce_bound[i]);
+            __m256i bb = _mm256_loadu_si256((const __m256i*)&beam_bounds[i]);
+
+            __m256i collision = _mm256_cmpeq_epi32(_mm256_and_si256(m, vBeam), vBeam);
+            __m256i old_bound = _mm256_blendv_epi8(rb, bb, collision);
+            __m256i invalid = _mm256_or_si256(_mm256_cmpeq_epi32(old_bound, vInvalid), _mm256_cmpgt_epi32(_mm256_sub_epi32(e, s), vRb));
+            __m256i profit = _mm256_max_epi32(vZero, _mm256_sub_epi32(old_bound, _mm256_add_epi32(s, vRb)));
+            profit = _mm256_blendv_epi8(profit, vMinusOne, invalid);
+
+            __m256i block_max = horizontalMax(profit);
+            int block_best = _mm256_cvtsi256_si32(block_max);
+            if (block_best > best_profit) {
+                int lanes = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(profit, block_max)));
+                best_index = i + lowestBit64((unsigned int)lanes);
+                best_profit = block_best;
+            }
+        }
+        return best_index;
+    }
+
+    SOLVER_TARGET_AVX512 int findBestReduceAvx512(const UserInfo& user, int& best_profit) const {
+        const int* beam_bounds = &beam_reduce_bound[user.beam * padded];
+        int best_index = -1;
+        best_profit = 0;
+
+        const __m512i vRb = _mm512_set1_epi32(user.rbNeed);
+        const __m512i vBeam = _mm512_set1_epi32(1 << user.beam);
+        const __m512i vInvalid = _mm512_set1_epi32(INT_MIN);
+        const __m512i vMinusOne = _mm512_set1_epi32(-1);
+        const __m512i vZero = _mm512_setzero_si512();
+
+        for (int i = 0; i < padded; i += AVX512_LANES) {
+            __m512i s = _mm512_loadu_si512(&start[i]);
+            __m512i e = _mm512_loadu_si512(&end[i]);
+            __m512i m = _mm512_loadu_si512(&mask[i]);
+            __m512i rb = _mm512_loadu_si512(&reduce_bound[i]);
+            __m512i bb = _mm512_loadu_si512(&beam_bounds[i]);
+
+            __m512i old_bound = _mm512_mask_blend_epi32(_mm512_test_epi32_mask(m, vBeam), rb, bb);
+            __mmask16 invalid = _mm512_cmpeq_epi32_mask(old_bound, vInvalid) | _mm512_cmpgt_epi32_mask(_mm512_sub_epi32(e, s), vRb);
+            __m512i profit = _mm512_max_epi32(vZero, _mm512_sub_epi32(old_bound, _mm512_add_epi32(s, vRb)));
+            profit = _mm512_mask_blend_epi32(invalid, profit, vMinusOne);
+
+            int block_best = _mm512_reduce_max_epi32(profit);
+            if (block_best > best_profit) {
+                __mmask16 lanes = _mm512_cmpeq_epi32_mask(profit, _mm512_set1_epi32(block_best));
+                best_index = i + lowestBit64(lanes);
+                best_profit = block_best;
+            }
+        }
+        return best_index;
+    }
+
+    SOLVER_TARGET_AVX2 int findInsertAvx2(const UserInfo& user, int L) const {
+        int first_or_shortest = -1;
+        int min_filled = L - 1;
+
+        const __m256i vRb = _mm256_set1_epi32(user.rbNeed);
+        const __m256i vFilled = _mm256_set1_epi32(L - 1);
+        const __m256i vBeam = _mm256_set1_epi32(1 << user.beam);
+        const __m256i vLast = _mm256_set1_epi32(count - 1);
+        const __m256i vSkip = _mm256_set1_epi32(INT_MAX);
+        const __m256i vLane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        for (int i = 0; i < padded; i += AVX2_LANES) {
+            __m256i s = _mm256_loadu_si256((const __m256i*)&start[i]);
+            __m256i e = _mm256_loadu_si256((const __m256i*)&end[i]);
+            __m256i sz = _mm256_loadu_si256((const __m256i*)&size[i]);
+            __m256i m = _mm256_loadu_si256((const __m256i*)&mask[i]);
+
+            // Интервалы отсортированы по убыванию длины, перебор заканчивается на первом слишком коротком
+            __m256i stop = _mm256_cmpgt_epi32(vRb, _mm256_sub_epi32(e, s));
+            stop = _mm256_or_si256(stop, _mm256_cmpgt_epi32(_mm256_add_epi32(vLane, _mm256_set1_epi32(i)), vLast));
+            int stop_lanes = _mm256_movemask_ps(_mm256_castsi256_ps(stop));
+
+            __m256i skip = _mm256_cmpeq_epi32(_mm256_and_si256(m, vBeam), vBeam);
+            skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(sz, vFilled));
+            if (stop_lanes) {
+                __m256i first_stop = _mm256_set1_epi32(lowestBit64((unsigned int)stop_lanes));
+                skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(vLane, _mm256_sub_epi32(first_stop, _mm256_set1_epi32(1))));
+            }
+            __m256i key = _mm256_blendv_epi8(sz, vSkip, skip);
+
+            __m256i block_min = horizontalMin(key);
+            int block_best = _mm256_cvtsi256_si32(block_min);
+            if (block_best <= min_filled) {
+                int lanes = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(key, block_min)));
+                first_or_shortest = i + highestBit64((unsigned int)lanes);
+                min_filled = block_best;
+            }
+
+            if (stop_lanes) break;
+        }
+        return first_or_shortest;
+    }
+
+    SOLVER_TARGET_AVX512 int findInsertAvx512(const UserInfo& user, int L) const {
+        int first_or_shortest = -1;
+        int min_filled = L - 1;
+
+        const __m512i vRb = _mm512_set1_epi32(user.rbNeed);
+        const __m512i vFilled = _mm512_set1_epi32(L - 1);
+        const __m512i vBeam = _mm512_set1_epi32(1 << user.beam);
+        const __m512i vLast = _mm512_set1_epi32(count - 1);
+        const __m512i vSkip = _mm512_set1_epi32(INT_MAX);
+        const __m512i vLane = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (int i = 0; i < padded; i += AVX512_LANES) {
+            __m512i s = _mm512_loadu_si512(&start[i]);
+            __m512i e = _mm512_loadu_si512(&end[i]);
+            __m512i sz = _mm512_loadu_si512(&size[i]);
+            __m512i m = _mm512_loadu_si512(&mask[i]);
+
+            __mmask16 stop = _mm512_cmpgt_epi32_mask(vRb, _mm512_sub_epi32(e, s));
+            stop |= _mm512_cmpgt_epi32_mask(_mm512_add_epi32(vLane, _mm512_set1_epi32(i)), vLast);
+
+            // Строки начиная с первой остановки отбрасываются
+            __mmask16 skip = _mm512_test_epi32_mask(m, vBeam) | _mm512_cmpgt_epi32_mask(sz, vFilled);
+            if (stop) skip |= (__mmask16)~((1u << lowestBit64(stop)) - 1);
+            __m512i key = _mm512_mask_blend_epi32(skip, sz, vSkip);
+
+            int block_best = _mm512_reduce_min_epi32(key);
+            if (block_best <= min_filled) {
+                __mmask16 lanes = _mm512_cmpeq_epi32_mask(key, _mm512_set1_epi32(block_best));
+                first_or_shortest = i + highestBit64(lanes);
+                min_filled = block_best;
+            }
+
+            if (stop) break;
+        }
+        return first_or_shortest;
+    }
+
+    SOLVER_TARGET_AVX2 static __m256 horizontalMax(__m256 v) {
+        v = _mm256_max_ps(v, _mm256_permute2f128_ps(v, v, 1));
+        v = _mm256_max_ps(v, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm256_max_ps(v, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+
+    SOLVER_TARGET_AVX2 static __m256i horizontalMax(__m256i v) {
+        v = _mm256_max_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+        v = _mm256_max_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm256_max_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+
+    SOLVER_TARGET_AVX2 static __m256i horizontalMin(__m256i v) {
+        v = _mm256_min_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+        v = _mm256_min_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm256_min_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+};
+
+thread_local IntervalsSoA intervals_view;
+
+inline void invalidateIntervalsView(int row) {
+    intervals_view.markDirty(row);
+}
+
+inline void invalidateIntervalsLayout() {
+    intervals_view.layout_valid = false;
+    intervals_view.splits_movable = false;
+}
+
+// Интервалы переставлены или добавлены, но сами не изменились
+inline void invalidateIntervalsOrder() {
+    if (intervals_view.layout_valid) intervals_view.splits_movable = true;
+    intervals_view.layout_valid = false;
+}
+
+inline IntervalsSoA& getIntervalsView(vector<MaskedInterval>& intervals, bool with_bounds) {
+    IntervalsSoA& view = intervals_view;
+    if (!view.layout_valid || !view.dirty_rows.empty() || (with_bounds && !view.stale_bounds.empty())) {
+        view.load(intervals, with_bounds);
+    }
+    return view;
+}
+
+#ifdef SOLVER_TRACE
+// Записи трассировки, формат разбирает trace_reader.py. Файл начинается с "STRC" и uint16 версии
+const uint16_t TRACE_VERSION = 2;
+
+enum TraceRecord : uint8_t {
+    TRACE_TEST = 'T',       // uint16 N, uint32 M, J, L
+    TRACE_RUN = 'R',        // int16 стратегия, -1 - базовый порядок
+    TRACE_STEP = 'S',       // начало шага, дальше изменения интервалов
+    TRACE_COUNT = 'C',      // uint32 количество интервалов
+    TRACE_INTERVAL = 'I',   // uint32 номер, start, end, uint16 количество, uint16 пользователи
+    TRACE_RUN_END = 'E'     // float оценка прогона
+};
+
+/// <summary>
+/// Двоичная трассировка шагов realSolver. Шаг пишет только интервалы, изменившиеся с прошлого шага.
+/// Записи копятся в заранее выделенном линейном буфере, который сбрасывается в файл, когда
+/// следующая запись в него не помещается
+/// </summary>
+struct StepTrace {
+    static const int CAPACITY = 1 << 20;
+
+    vector<uint8_t> buffer;
+    int size = 0;
+    FILE* file = nullptr;
+
+    // последнее записанное состояние, относительно которого пишутся изменения
+    vector<MaskedInterval> last;
+
+    void flush() {
+        if (file != nullptr && size > 0) fwrite(buffer.data(), 1, size, file);
+        size = 0;
+    }
+
+    void reserve(int bytes) {
+        if (size + bytes > CAPACITY) flush();
+    }
+
+    void put8(uint8_t value) {
+        buffer[size++] = value;
+    }
+
+    void put16(uint16_t value) {
+        buffer[size++] = (uint8_t)value;
+        buffer[size++] = (uint8_t)(value >> 8);
+    }
+
+    void put32(uint32_t value) {
+        put16((uint16_t)value);
+        put16((uint16_t)(value >> 16));
+    }
+
+    void putFloat(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        put32(bits);
+    }
+};
+
+thread_local StepTrace step_trace;
+
+inline bool traceOpen(const char* path) {
+    step_trace.buffer.resize(StepTrace::CAPACITY);
+    step_trace.size = 0;
+    step_trace.file = fopen(path, "wb");
+    if (step_trace.file == nullptr) return false;
+    memcpy(step_trace.buffer.data(), "STRC", 4);
+    step_trace.size = 4;
+    step_trace.put16(TRACE_VERSION);
+    return true;
+}
+
+inline void traceClose() {
+    step_trace.flush();
+    if (step_trace.file != nullptr) fclose(step_trace.file);
+    step_trace.file = nullptr;
+}
+
+inline void traceTest(int N, int M, int J, int L) {
+    if (step_trace.file == nullptr) return;
+    step_trace.reserve(15);
+    step_trace.put8(TRACE_TEST);
+    step_trace.put16((uint16_t)N);
+    step_trace.put32((uint32_t)M);
+    step_trace.put32((uint32_t)J);
+    step_trace.put32((uint32_t)L);
+}
+
+inline void traceRun(int strategy) {
+    if (step_trace.file == nullptr) return;
+    step_trace.last.clear();
+    step_trace.reserve(3);
+    step_trace.put8(TRACE_RUN);
+    step_trace.put16((uint16_t)(int16_t)strategy);
+}
+
+inline void traceStep(const vector<MaskedInterval>& intervals) {
+    StepTrace& trace = step_trace;
+    if (trace.file == nullptr) return;
+    // шаг может занять больше буфера, поэтому место резервируется под каждую запись
+    trace.reserve(6);
+    trace.put8(TRACE_STEP);
+    if (intervals.size() != trace.last.size()) {
+        trace.put8(TRACE_COUNT);
+        trace.put32((uint32_t)intervals.size());
+        trace.last.resize(intervals.size(), MaskedInterval(-1, -1));
+    }
+    for (int i = 0; i < (int)intervals.size(); ++i) {
+        const MaskedInterval& interval = intervals[i];
+        MaskedInterval& last = trace.last[i];
+        if (interval.start == last.start && interval.end == last.end && interval.users == last.users) continue;
+        last.start = interval.start;
+        last.end = interval.end;
+        last.users = interval.users;
+
+        trace.reserve(15 + 2 * (int)interval.users.size());
+        trace.put8(TRACE_INTERVAL);
+        trace.put32((uint32_t)i);
+        trace.put32((uint32_t)interval.start);
+        trace.put32((uint32_t)interval.end);
+        trace.put16((uint16_t)interval.users.size());
+        for (int u : interval.users) trace.put16((uint16_t)u);
+    }
+}
+
+inline void traceRunEnd(float value) {
+    if (step_trace.file == nullptr) return;
+    step_trace.reserve(5);
+    step_trace.put8(TRACE_RUN_END);
+    step_trace.putFloat(value);
+}
+
+#define TRACE_TEST(N, M, J, L) traceTest(N, M, J, L)
+#define TRACE_RUN(strategy) traceRun(strategy)
+#define TRACE_STEP(intervals) traceStep(intervals)
+#define TRACE_RUN_END(value) traceRunEnd(value)
+#else
+#define TRACE_TEST(N, M, J, L)
+#define TRACE_RUN(strategy)
+#define TRACE_STEP(intervals)
+#define TRACE_RUN_END(value)
+#endif
+
+inline bool sortUsersByRbNeedDescendingComp(UserId id1, UserId id2) {
+    return user_table.order_key[id1] > user_table.order_key[id2];
+}
+
+inline bool sortIntervalsDescendingComp(const MaskedInterval& I1, const MaskedInterval& I2) {
+
+    int l1 = I1.getLength(), l2 = I2.getLength();
+
+    if (l1 == l2) {
+        int users1 = I1.users.size(), users2 = I2.users.size();
+        return users1 > users2;
+    }
+
+    return l1 > l2;
+}
+
+/// <summary>
+/// Битовая карта блоков [0, size): бит на RB. Промежутки, пересечения и число занятых блоков
+/// считаются по 64 блока за операцию. Память слов только растёт и переиспользуется
+/// </summary>
+struct RBBitmap {
+    vector<uint64_t> words;
+    int size = 0;
+
+    void reset(int M) {
+        size = M;
+        words.assign((M + 63) / 64, 0);
+    }
+
+    // Маска битов [start, end) внутри слова word
+    static uint64_t wordMask(int word, int start, int end) {
+        int from = max(start - word * 64, 0), to = min(end - word * 64, 64);
+        uint64_t high = to >= 64 ? ~0ull : (1ull << to) - 1;
+        return high & ~((1ull << from) - 1);
+    }
+
+    void setRange(int start, int end) {
+        for (int w = start / 64; w * 64 < end; ++w) words[w] |= wordMask(w, start, end);
+    }
+
+    void clearRange(int start, int end) {
+        for (int w = start / 64; w * 64 < end; ++w) words[w] &= ~wordMask(w, start, end);
+    }
+
+    bool test(int rb) const {
+        return (words[rb / 64] >> (rb % 64)) & 1;
+    }
+
+    bool anyInRange(int start, int end) const {
+        for (int w = start / 64; w * 64 < end; ++w) {
+            if (words[w] & wordMask(w, start, end)) return true;
+        }
+        return false;
+    }
+
+    int countRange(int start, int end) const {
+        int count = 0;
+        for (int w = start / 64; w * 64 < end; ++w) count += popCount64(words[w] & wordMask(w, start, end));
+        return count;
+    }
+
+    // Первый занятый блок не раньше from, size - если такого нет
+    int findSet(int from) const {
+        if (from >= size) return size;
+        int w = from / 64;
+        uint64_t word = words[w] & (~0ull << (from % 64));
+        while (word == 0) {
+            if (++w == (int)words.size()) return size;
+            word = words[w];
+        }
+        return min(size, w * 64 + lowestBit64(word));
+    }
+
+    // Первый свободный блок не раньше from, size - если такого нет
+    int findClear(int from) const {
+        if (from >= size) return size;
+        int w = from / 64;
+        uint64_t word = ~words[w] & (~0ull << (from % 64));
+        while (word == 0) {
+            if (++w == (int)words.size()) return size;
+            word = ~words[w];
+        }
+        return min(size, w * 64 + lowestBit64(word));
+    }
+};
+
+/// <summary>
+/// Занятость блоков по лучам: бит RB в карте beam стоит, если блок отдан пользователю этого луча.
+/// Число пользователей на RB - сумма битов по лучам, конфликт луча - пересечение с его картой
+/// </summary>
+struct BeamOccupancy {
+    static const int BEAMS = 32;
+
+    RBBitmap beams[BEAMS];
+    // лучи, карта которых не пуста
+    uint32_t used = 0;
+
+    void reset(int M) {
+        for (auto& bitmap : beams) bitmap.reset(M);
+        used = 0;
+    }
+
+    // Возвращает false, если луч уже занят на части [start, end), тогда карта не меняется
+    bool occupy(int beam, int start, int end) {
+        if (beams[beam].anyInRange(start, end)) return false;
+        beams[beam].setRange(start, end);
+        used |= 1u << beam;
+        return true;
+    }
+
+    void release(int beam, int start, int end) {
+        beams[beam].clearRange(start, end);
+    }
+
+    bool isFree(int beam, int start, int end) const {
+        return !beams[beam].anyInRange(start, end);
+    }
+
+    // Сколько лучей занимают блок rb
+    int coverage(int rb) const {
+        int count = 0;
+        for (uint32_t mask = used; mask != 0; mask &= mask - 1) count += beams[lowestBit64(mask)].test(rb);
+        return count;
+    }
+};
+
+thread_local RBBitmap reserved_bitmap;
+
+// Свободные от резерва отрезки по возрастанию. Резерв может идти в любом порядке,
+// касаться и пересекаться, в том числе начинаться с блока 0
+inline void getNonReservedIntervals(const vector<Interval>& reserved, int M, vector<MaskedInterval>& result) {
+    RBBitmap& bitmap = reserved_bitmap;
+    bitmap.reset(M);
+    for (const auto& R : reserved) bitmap.setRange(max(R.start, 0), min(R.end, M));
+
+    result.clear();
+    for (int start = bitmap.findClear(0); start < M; ) {
+        int end = bitmap.findSet(start);
+        result.push_back(MaskedInterval(start, end));
+        start = bitmap.findClear(end);
+    }
+}
+
+inline int getSplitIndex(const MaskedInterval& interval, float loss_threshold) {
+    /*
+        \         |
+         \        |
+           \      |
+              \   |-------------| loss
+        -.-.-.-.-.-.-.-.-.-.-.-.- startSplitIndex
+                  \
+                  |       \
+                  |             \
+        Все что справа от черты округляется вправо, слева округляется по черте
+        до разделения округление было вправо для всех
+
+        Если разделение по loss не произошло, но есть свободное место на последнем уровне > last_split_attempt_threshold, то произойдет разделение по последнему
+    */
+
+    int start_split_index = 0;
+    for (; start_split_index < interval.users.size(); ++start_split_index) {
+        float loss = interval.end - min(interval.end, user_intervals[interval.users[start_split_index]].second);
+        if (loss > loss_threshold) {
+            break;
+        }
+    }
+
+    if (start_split_index == interval.users.size() && interval.users.size() > 0 && interval.getMaxLoss() > last_split_attempt_threshold) {
+        start_split_index--;
+    }
+
+    return start_split_index;
+}
+
+inline pair<int, int> getSplitPositionAndIndex(vector<MaskedInterval>& intervals, int index, float loss_threshold) {
+    MaskedInterval& interval = intervals[index];
+    int length = interval.getLength();
+    if (length < 2) {
+        return { -1, -1 };
+    }
+
+    int start_split_index = getSplitIndex(interval, loss_threshold);
+    if (start_split_index == interval.users.size()) {
+        return { -1, -1 };
+    }
+
+    int middle_position = user_intervals[interval.users[start_split_index]].second;
+    if (middle_position <= interval.start || middle_position >= interval.end) {
+        return { -1, -1 };
+    }
+
+    return { middle_position, start_split_index };
+}
+
+/// <summary>
+/// Разделяет интервал для экономии места, при этом счёт не уменьшается
+/// |-----|    |--|  |
+/// |-----| -> |--|  |
+/// |-----|    |-----|
+/// |-----|    |-----|
+/// </summary>
+inline StepStatus trySplitInterval(vector<MaskedInterval>& intervals, int index, float loss_threshold) {
+
+    pair<int, int> split = getSplitPositionAndIndex(intervals, index, loss_threshold);
+    int middle_position = split.first;
+    int start_split_index = split.second;
+    if (middle_position == -1) return STEP_SKIPPED;
+
+
+    MaskedInterval& interval = intervals[index]; 
+    MaskedInterval intL(interval.start, middle_position);
+    MaskedInterval intR(middle_position, interval.end);
+
+    for (int i = 0; i < interval.users.size(); i++) {
+        if (user_intervals[interval.users[i]].second > middle_position) {
+            if (!intR.insertSplitUser(user_table.get(interval.users[i]))) return STEP_FAILED;
+        }
+        if (!intL.insertSplitUser(user_table.get(interval.users[i]))) return STEP_FAILED;
+    }
+
+    intervals[index] = intR;
+    intervals.push_back(intL);
+    invalidateIntervalsOrder();
+
+    return STEP_DONE;
+}
+
+inline float getLossThresholdMultiplier(int user_index, int users_count) {
+    float x = (float)user_index / users_count;
+    return loss_threshold_multiplier_A * x + loss_threshold_multiplier_B;
+}
+
+inline StepStatus tryReplaceUser(vector<MaskedInterval>& intervals, const UserInfo& user, int replace_threshold, int overfill_threshold, int L, DeferredSet& deferred, bool reinsert) {
+
+    IntervalsSoA& view = getIntervalsView(intervals, true);
+    ReplaceMemo& memo = replace_memo[user.id];
+    bool may_profit = view.replaceMayProfit(memo, user, replace_threshold, overfill_threshold, L);
+#ifndef SOLVER_CHECK_INVARIANTS
+    if (!may_profit) return STEP_SKIPPED;
+#endif
+
+    float best_profit = 0;
+    int best_index = view.findBestReplace(user, replace_threshold, overfill_threshold, L, best_profit);
+#ifdef SOLVER_CHECK_INVARIANTS
+    if (!may_profit && best_profit > replace_threshold && best_index != -1) reportSolverError("tryReplaceUser: replace memo skipped a profitable replacement");
+#endif
+
+    if (best_profit > replace_threshold && best_index != -1) {
+        int replace_index = intervals[best_index].getInsertionProfit(user, L).second;
+        int deferred_index;
+        if (!intervals[best_index].replaceUser(user, replace_index, deferred_index)) return STEP_FAILED;
+        if (reinsert && deferred_index >= 0) {
+            deferred.insert(deferred_index);
+        }
+        return STEP_DONE;
+    }
+
+    memo = view.makeReplaceMemo(replace_threshold, overfill_threshold);
+    return STEP_SKIPPED;
+}
+
+inline StepStatus tryReduceUser(vector<MaskedInterval>& intervals, const UserInfo& user, int replace_threshold, DeferredSet& deferred) {
+
+    int best_profit = 0;
+    int best_index = getIntervalsView(intervals, true).findBestReduce(user, best_profit);
+
+    if (best_profit > replace_threshold && best_index != -1) {
+        int reduce_index = intervals[best_index].getReduceProfit(user).second;
+        int deferred_index;
+        if (!intervals[best_index].replaceUser(user, reduce_index, deferred_index)) return STEP_FAILED;
+        if (deferred_index == -1) {
+            reportSolverError("tryReduceUser: deferred_index == -1");
+            return STEP_FAILED;
+        }
+
+        deferred.insert(deferred_index);
+        return STEP_DONE;
+    }
+
+    return STEP_SKIPPED;
+}
+
+inline int findInsertIndex(vector<MaskedInterval>& intervals, const UserInfo& user, int L) {
+
+    return getIntervalsView(intervals, false).findInsert(user, L);
+}
+
+#ifdef SOLVER_CHECK_INVARIANTS
+// Перебор без кэша строк IntervalsSoA, для сверки с findSplit
+inline int findIntervalToSplitDirect(vector<MaskedInterval>& intervals, const UserInfo& user, float loss_threshold_multiplier, int L) {
+
+    float minPosition = 1000;
+    int maxProfit = 0;
+    int optimal_index = -1;
+    for (int i = 0; i < intervals.size(); i++) {
+        float loss_threshold = user.rbNeed * loss_threshold_multiplier;
+
+        auto res = getSplitPositionAndIndex(intervals, i, loss_threshold);
+        if (res.first != -1) {
+            float value = res.second;
+            int profit = intervals[i].getInsertionProfit(user, L).first;
+
+            if (value < minPosition || value == minPosition && profit > maxProfit) {
+                minPosition = value;
+                maxProfit = profit;
+                optimal_index = i;
+            }
+        }
+    }
+    return optimal_index;
+}
+#endif
+
+inline int findIntervalToSplit(vector<MaskedInterval>& intervals, const UserInfo& user, float loss_threshold_multiplier, int L) {
+
+    IntervalsSoA& view = getIntervalsView(intervals, false);
+    if (!view.stale_splits.empty()) view.loadStaleSplits(intervals);
+    int index = view.findSplit(intervals, user, loss_threshold_multiplier, L);
+#ifdef SOLVER_CHECK_INVARIANTS
+    if (index != findIntervalToSplitDirect(intervals, user, loss_threshold_multiplier, L)) reportSolverError("findSplit: cached split candidates are stale");
+#endif
+    return index;
+}
+
+
+// Возвращает false при ошибке
+inline bool splitRoutine(vector<MaskedInterval>& intervals, const UserInfo& user, int index, float loss_threshold_multiplier) {
+    if (index == -1) {
+        return reportSolverError("splitRoutine: index == -1");
+    }
+
+    // Здесь почему то нужно ограничивать а при поиске нет, надо бы разобраться почему
+    float lossThreshold = min(intervals[index].getLength(), user.rbNeed) * loss_threshold_multiplier;
+    if (trySplitInterval(intervals, index, lossThreshold) == STEP_FAILED) return false;
+    sort(intervals.begin(), intervals.end(), sortIntervalsDescendingComp);
+    invalidateIntervalsOrder();
+
+    return true;
+}
+
+// Возвращает false при ошибке
+inline bool reinsertRoutine(vector<MaskedInterval>& intervals, int N, int L) {
+    // оптимизация перевставкой
+    for (size_t i = 0; i < N; i++) {
+        if (user_intervals[i].first == -1) continue;
+        int fill = user_intervals[i].second - user_intervals[i].first;
+        if (fill >= user_table.rbNeed[i]) continue;
+
+        int max_profit = 0;
+        int optimal_index = -1;
+        for (size_t j = 0; j < intervals.size(); ++j) {
+            auto& interval = intervals[j];
+            if (interval.getLength() <= fill) break;
+            if (interval.users.size() >= L || interval.hasMaskCollision(user_table.get(i))) continue;
+
+            int new_length = min(user_table.rbNeed[i], interval.getLength());
+            int profit = new_length - fill;
+            if (profit >= max_profit) {
+                max_profit = profit;
+                optimal_index = j;
+            }
+        }
+
+        if (optimal_index == -1) continue;
+
+        // delete
+        for (auto& interval : intervals) interval.eraseUser(i);
+        user_intervals[i] = { -1, -1 };
+        if (!intervals[optimal_index].insertNewUser(user_table.get(i))) return false;
+    }
+
+    return true;
+}
+
+inline int getMaxTestScore(int M, int L, const vector<Interval>& reserved) {
+
+    int max_test_score = M;
+    for (const auto& R : reserved) {
+        max_test_score -= R.end - R.start;
+    }
+
+    return max_test_score;
+}
+
+// Сдвиг вправо меняет границы пользователей только в рабочей копии user_bounds, у вызывающего они прежние
+inline StepStatus move_bounds_right(vector<MaskedInterval>& intervals, const vector<pair<int, int>>& user_bounds, vector<pair<int, int>>& actual_user_intervals, vector<int>& right_intervals) {
+    actual_user_intervals = user_bounds;
+    right_intervals.resize(actual_user_intervals.size());
+    bool success = false;
+
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        for (auto u : intervals[i].users) right_intervals[u] = i;
+    }
+
+    for (size_t i = 1; i < intervals.size(); ++i) {
+        MaskedInterval& right = intervals[i];
+        MaskedInterval& left = intervals[i - 1];
+
+        if (left.end != right.start || right.getLength() <= 1) {
+            continue;
+        }
+
+        int rightLoss = 0;
+        for (auto u : right.users) {
+            if (actual_user_intervals[u].first == -1) {
+                reportSolverError("move_bounds: user without interval");
+                return STEP_FAILED;
+            }
+            if (actual_user_intervals[u].second == intervals[right_intervals[u]].end) rightLoss++;
+        }
+        int leftProfit = 0;
+        for (auto u : left.users) {
+            if (actual_user_intervals[u].first == -1) {
+                reportSolverError("move_bounds: user without interval");
+                return STEP_FAILED;
+            }
+            if (actual_user_intervals[u].second != left.end) continue;
+            int fill = actual_user_intervals[u].second - actual_user_intervals[u].first;
+            if (fill < user_table.rbNeed[u]) leftProfit++;
+        }
+
+        if (leftProfit > rightLoss) {
+            // move right
+            for (auto u : left.users)
+                if (actual_user_intervals[u].second = left.end)
+                    if (actual_user_intervals[u].second - actual_user_intervals[u].first < user_table.rbNeed[u])
+                        actual_user_intervals[u].second++;
+
+            for (auto u : right.users) {
+                if (actual_user_intervals[u].first == right.start) {
+                    actual_user_intervals[u].first++;
+                    actual_user_intervals[u].second = min(intervals[right_intervals[u]].end, actual_user_intervals[u].second + 1);
+                }
+            }
+
+            left.end++;
+            right.start++;
+            success = true;
+        }
+    }
+
+    return success ? STEP_DONE : STEP_SKIPPED;
+}
+
+inline StepStatus move_bounds_left(vector<MaskedInterval>& intervals, vector<pair<int, int>>& actual_user_intervals) {
+    // двигать границы интервалов
+    bool success = false;
+    for (size_t i = intervals.size() - 1; i >= 1; --i) {
+        MaskedInterval& right = intervals[i];
+        MaskedInterval& left = intervals[i - 1];
+
+        if (left.end != right.start) {
+            continue;
+        }
+
+        int leftLoss = 0;
+        for (auto u : left.users) {
+            if (actual_user_intervals[u].first == -1) {
+                reportSolverError("move_bounds: user without interval");
+                return STEP_FAILED;
+            }
+            if (actual_user_intervals[u].second == left.end) leftLoss++;
+        }
+        int rightProfit = 0;
+        for (auto u : right.users) {
+            if (actual_user_intervals[u].first == -1) {
+                reportSolverError("move_bounds: user without interval");
+                return STEP_FAILED;
+            }
+            if (actual_user_intervals[u].first != right.start) continue;
+            int fill = actual_user_intervals[u].second - actual_user_intervals[u].first;
+            if (fill < user_table.rbNeed[u]) rightProfit++;
+        }
+
+        if (rightProfit > leftLoss && left.getLength() > 1) {
+            // move left
+            for (auto u : left.users)
+                if (actual_user_intervals[u].second == left.end)
+                    --actual_user_intervals[u].second;
+            for (auto u : right.users)
+                if (actual_user_intervals[u].first == right.start) {
+                    --actual_user_intervals[u].first;
+                    if (actual_user_intervals[u].second - actual_user_intervals[u].first > user_table.rbNeed[u])
+                        --actual_user_intervals[u].second;
+                }
+            left.end--;
+            right.start--;
+            success = true;
+        }
+    }
+    return success ? STEP_DONE : STEP_SKIPPED;
+}
+
+inline float checker(int N, int M, int K, int J, int L, int max_test_score_row) {
+
+    int output_score = 0;
+
+    for (size_t i = 0; i < N; ++i) {
+        if (user_intervals[i].first != -1) {
+            output_score += user_intervals[i].second - user_intervals[i].first;
+        }
+    }
+
+    int totalScore = max_test_score_row * L;
+    float testScore = output_score * 100.0f / (float)totalScore;
+
+    return testScore;
+}
+
+void riffle_shuffle(vector<UserId>& vec, int startIndex, int endIndex) {
+    int i = (startIndex + endIndex) / 2;
+    int j = endIndex - 1;
+    while (i > startIndex) {
+        UserId temp = vec[i];
+        vec[i--] = vec[j];
+        vec[j--] = temp;
+    }
+}
+
+void shuffle(vector<UserId>& vec, int startIndex, int endIndex, mt19937& rng) {
+    int length = endIndex - startIndex;
+    for (int i = endIndex - 1; i > startIndex; --i) {
+        int index = rng() % length;
+        UserId temp = vec[i];
+        vec[i] = vec[startIndex + index];
+        vec[startIndex + index] = temp;
+    }
+}
+
+// Инверсия блоков длины 4
+void reverseBlocks4(vector<UserId>& order, int, mt19937&) {
+    for (int i = 0; i < (int)order.size(); i += 4) {
+        if (i + 3 < (int)order.size()) {
+            swap(order[i], order[i + 3]);
+            swap(order[i + 1], order[i + 2]);
+        }
+    }
+}
+
+// Свапы соседних
+void swapAdjacent(vector<UserId>& order, int, mt19937&) {
+    for (int i = 0; i < (int)order.size(); i += 2) {
+        if (i + 1 < (int)order.size()) {
+            swap(order[i], order[i + 1]);
+        }
+    }
+}
+
+// Инверсия блоков длины 3
+void reverseBlocks3(vector<UserId>& order, int, mt19937&) {
+    for (int i = 0; i < (int)order.size(); i += 3) {
+        if (i + 2 < (int)order.size()) {
+            swap(order[i], order[i + 2]);
+        }
+    }
+}
+
+// Хитрая инверсия блоков длины 6
+void reverseBlocks6(vector<UserId>& order, int, mt19937&) {
+    for (int i = 0; i < (int)order.size(); i += 6) {
+        if (i + 5 < (int)order.size()) {
+            swap(order[i], order[i + 5]);
+            //swap(order[i + 1], order[i + 4]);
+            swap(order[i + 2], order[i + 3]);
+        }
+    }
+}
+
+// random_shuffle полных блоков длины size
+void shuffleBlocks(vector<UserId>& order, int size, mt19937& rng) {
+    for (int i = 0; i < (int)order.size(); i += size) {
+        if (i + size < (int)order.size()) {
+            shuffle(order, i, i + size, rng);
+        }
+    }
+}
+
+// riffle_shuffle полных блоков длины size
+void riffleBlocks(vector<UserId>& order, int size, mt19937&) {
+    for (int i = 0; i < (int)order.size(); i += size) {
+        if (i + size < (int)order.size()) {
+            riffle_shuffle(order, i, i + size);
+        }
+    }
+}
+
+/// <summary>
+/// Стратегия перестановки отсортированного порядка пользователей и её статистика
+/// по всем вызовам Solver
+/// </summary>
+struct OrderStrategy {
+    string name;
+    // номер в test_metrics
+    int test_index;
+    // случайные стратегии берут числа только из rng экземпляра
+    void (*apply)(vector<UserId>& order, int param, mt19937& rng);
+    int param;
+    // выполняется только при random_enable
+    bool optional;
+
+    int runs = 0;
+    // прогонов строго лучше базового порядка
+    int wins = 0;
+    // суммарный прирост оценки над базовым порядком
+    double gain = 0;
+    int skipped = 0;
+};
+
+inline vector<OrderStrategy> getDefaultOrderStrategies() {
+    vector<OrderStrategy> strategies;
+    strategies.push_back({ "reverse-4", 2, reverseBlocks4, 4, false });
+    strategies.push_back({ "swap-adjacent", 3, swapAdjacent, 2, false });
+    strategies.push_back({ "reverse-3", 4, reverseBlocks3, 3, false });
+    strategies.push_back({ "reverse-6", 5, reverseBlocks6, 6, false });
+    for (int size = 6; size < 16; ++size) strategies.push_back({ "shuffle-" + to_string(size), 6, shuffleBlocks, size, true });
+    for (int size = 5; size < 10; ++size) strategies.push_back({ "riffle-" + to_string(size), 6, riffleBlocks, size, true });
+    return strategies;
+}
+
+// Реестр стратегий: базовый отсортированный порядок всегда считается первым,
+// остальные запускаются в порядке, выбранном планировщиком
+vector<OrderStrategy> order_strategies = getDefaultOrderStrategies();
+
+inline void registerOrderStrategy(const string& name, int test_index, void (*apply)(vector<UserId>& order, int param, mt19937& rng), int param, bool optional = false) {
+    order_strategies.push_back({ name, test_index, apply, param, optional });
+}
+
+inline vector<OrderStrategy>& getOrderStrategies() {
+    return order_strategies;
+}
+
+// коэффициент исследования в верхней доверительной границе доли побед
+float strategy_exploration = 0.5f;
+// число запусков, до которого стратегия никогда не пропускается
+int strategy_warmup_runs = 200;
+// стратегии с меньшей долей побед после разогрева пропускаются
+float strategy_min_win_rate = 0.002f;
+// пропускаемая стратегия всё равно запускается в каждом strategy_explore_period-м вызове
+int strategy_explore_period = 16;
+// ограничение времени одного вызова Solver в микросекундах, 0 - без ограничения
+int solver_time_budget_us = 0;
+
+int solver_calls = 0;
+
+// Статистика стратегий и test_metrics общие для всех потоков
+mutex strategy_stats_mutex;
+
+void setSolverTimeBudget(int microseconds) {
+    solver_time_budget_us = microseconds;
+}
+
+inline void resetOrderStrategyStats() {
+    lock_guard<mutex> lock(strategy_stats_mutex);
+    for (auto& strategy : order_strategies) {
+        strategy.runs = 0;
+        strategy.wins = 0;
+        strategy.gain = 0;
+        strategy.skipped = 0;
+    }
+    solver_calls = 0;
+}
+
+inline float getStrategyPriority(const OrderStrategy& strategy, int total_runs) {
+    if (strategy.runs == 0) return 1e9f;
+    float win_rate = (float)strategy.wins / strategy.runs;
+    float mean_gain = (float)(strategy.gain / strategy.runs);
+    return win_rate + mean_gain + strategy_exploration * sqrt(log((float)total_runs + 1) / strategy.runs);
+}
+
+/// <summary>
+/// Выбирает стратегии для текущего вызова Solver: сначала с наибольшей верхней границей,
+/// редко помогающие после разогрева пропускаются, кроме исследовательских вызовов.
+/// priorities - рабочий буфер, результат записывается в scheduled. Считает вызов в solver_calls
+/// </summary>
+inline void scheduleOrderStrategies(bool random_enable, vector<pair<float, int>>& priorities, vector<int>& scheduled) {
+    lock_guard<mutex> lock(strategy_stats_mutex);
+    int total_runs = 0;
+    for (const auto& strategy : order_strategies) total_runs += strategy.runs;
+
+    bool explore = strategy_explore_period > 0 && solver_calls % strategy_explore_period == 0;
+
+    priorities.clear();
+    for (int i = 0; i < (int)order_strategies.size(); ++i) {
+        OrderStrategy& strategy = order_strategies[i];
+        if (strategy.optional && !random_enable) continue;
+        if (!explore && strategy.runs >= strategy_warmup_runs && strategy.wins < strategy_min_win_rate * strategy.runs) {
+            ++strategy.skipped;
+            continue;
+        }
+        priorities.push_back({ getStrategyPriority(strategy, total_runs), i });
+    }
+    // равные приоритеты в порядке регистрации; stable_sort выделял бы буфер
+    sort(priorities.begin(), priorities.end(), [](const pair<float, int>& l, const pair<float, int>& r) { return l.first > r.first || (l.first == r.first && l.second < r.second); });
+
+    scheduled.clear();
+    for (const auto& p : priorities) scheduled.push_back(p.second);
+    ++solver_calls;
+}
+
+// Результат прогона стратегии относительно базового порядка того же вызова
+inline void recordStrategyRun(int index, float value, float base_value) {
+    lock_guard<mutex> lock(strategy_stats_mutex);
+    OrderStrategy& strategy = order_strategies[index];
+    ++strategy.runs;
+    if (value > base_value) {
+        ++strategy.wins;
+        strategy.gain += value - base_value;
+    }
+}
+
+inline void recordBestTestIndex(int test_index) {
+    lock_guard<mutex> lock(strategy_stats_mutex);
+    ++test_metrics[test_index];
+}
+
+#ifdef SOLVER_CHECK_INVARIANTS
+thread_local RBBitmap check_bitmap;
+thread_local RBBitmap check_answer_bitmap;
+thread_local BeamOccupancy check_occupancy;
+
+/// <summary>
+/// Проверка расписания внутри realSolver после каждого изменения: границы интервалов,
+/// вместимость L, маска лучей и mask_indices, границы пользователей и отложенные пользователи
+/// </summary>
+inline void checkScheduleInvariants(const vector<MaskedInterval>& intervals, int M, int L, const DeferredSet& deferred) {
+    RBBitmap& occupied = check_bitmap;
+    occupied.reset(M);
+    for (const auto& interval : intervals) {
+        if (interval.start < 0 || interval.start >= interval.end || interval.end > M) {
+            reportSolverError("interval is out of [0, M) or empty");
+            continue;
+        }
+        if (occupied.anyInRange(interval.start, interval.end)) reportSolverError("intervals overlap");
+        occupied.setRange(interval.start, interval.end);
+        if (interval.users.size() > L) reportSolverError("interval has more than L users");
+
+        unsigned int mask = 0;
+        for (int k = 0; k < interval.users.size(); ++k) {
+            int user_id = interval.users[k];
+            int beam = user_table.beam[user_id];
+            if (mask & (1u << beam)) reportSolverError("two users with the same beam in one interval");
+            mask |= 1u << beam;
+            if (interval.mask_indices[beam] != k) reportSolverError("mask_indices is out of sync with users");
+
+            const auto& bound = user_intervals[user_id];
+            if (bound.first == -1 || bound.first > interval.start || bound.second <= interval.start) reportSolverError("user bounds do not cover the interval");
+        }
+        if (mask != interval.mask) reportSolverError("mask is out of sync with users");
+    }
+
+    for (auto user_id : deferred) {
+        if (user_intervals[user_id].first != -1) reportSolverError("deferred user is scheduled");
+    }
+}
+
+/// <summary>
+/// Проверка ответа Solver: не больше J интервалов, не больше L пользователей с разными лучами
+/// в интервале, интервалы не пересекаются между собой и с зарезервированными
+/// </summary>
+inline void checkAnswerInvariants(const vector<Interval>& answer, int M, int J, int L, const vector<Interval>& reserved) {
+    if ((int)answer.size() > J) reportSolverError("answer has more than J intervals");
+
+    RBBitmap& blocked = check_bitmap;
+    blocked.reset(M);
+    for (const auto& R : reserved) blocked.setRange(max(R.start, 0), min(R.end, M));
+
+    // лучи по блокам: один луч дважды на блоке - два пользователя луча в интервале или пересечение интервалов
+    BeamOccupancy& occupancy = check_occupancy;
+    occupancy.reset(M);
+    RBBitmap& occupied = check_answer_bitmap;
+    occupied.reset(M);
+    for (const auto& interval : answer) {
+        if (interval.start < 0 || interval.start >= interval.end || interval.end > M) {
+            reportSolverError("answer interval is out of [0, M) or empty");
+            continue;
+        }
+        if ((int)interval.users.size() > L) reportSolverError("answer interval has more than L users");
+        if (blocked.anyInRange(interval.start, interval.end)) reportSolverError("answer interval overlaps a reserved one");
+        if (occupied.anyInRange(interval.start, interval.end)) reportSolverError("answer intervals overlap");
+        occupied.setRange(interval.start, interval.end);
+
+        for (int user_id : interval.users) {
+            if (!occupancy.occupy(user_table.beam[user_id], interval.start, interval.end)) reportSolverError("answer interval has two users with the same beam");
+        }
+    }
+}
+
+#define CHECK_SCHEDULE(intervals, M, L, deferred) checkScheduleInvariants(intervals, M, L, deferred)
+#define CHECK_ANSWER(answer, M, J, L, reserved) checkAnswerInvariants(answer, M, J, L, reserved)
+#else
+#define CHECK_SCHEDULE(intervals, M, L, deferred)
+#define CHECK_ANSWER(answer, M, J, L, reserved)
+#endif
+
+// Классы экземпляров: три бита признаков, см. getInstanceClass
+const int INSTANCE_CLASSES = 8;
+
+/// <summary>
+/// Класс экземпляра по признакам, от которых зависят лучшие параметры:
+/// бит 0 - суммарный rbNeed больше ёмкости свободных блоков (M, K, L, число beam),
+/// бит 1 - J > 8, бит 2 - на интервал помещается больше 4 пользователей
+/// </summary>
+inline int getInstanceClass(int M, int J, int L, const vector<Interval>& reserved, const vector<UserInfo>& users) {
+    unsigned int beams_mask = 0;
+    long long total_need = 0;
+    for (const auto& user : users) {
+        beams_mask |= 1u << user.beam;
+        total_need += user.rbNeed;
+    }
+    int effective_L = min(L, popCount64(beams_mask));
+    long long capacity = (long long)getMaxTestScore(M, L, reserved) * effective_L;
+
+    int instance_class = 0;
+    if (total_need > capacity) instance_class |= 1;
+    if (J > 8) instance_class |= 2;
+    if (effective_L > 4) instance_class |= 4;
+    return instance_class;
+}
+
+// Таблица подобрана tuneInstanceClasses (Project.cpp) на open.txt:
+// параметры подбирались на чётных тестах класса и принимались, только если
+// не ухудшали нечётные
+SolverParams instance_class_params[INSTANCE_CLASSES] = {
+    { -0.283f, 0.972f, 3, 100 }, // 0
+    { 0.100f, 0.700f, 2, 100 }, // 1
+    { 0.100f, 0.900f, 3, 100 }, // 2
+    { -0.283f, 0.972f, 3, 100 }, // 3
+    { -0.283f, 0.972f, 3, 100 }, // 4
+    { -0.283f, 0.972f, 3, 100 }, // 5
+    { -0.283f, 0.972f, 3, 100 }, // 6
+    { 0.100f, 0.900f, 3, 100 }, // 7
+};
+
+bool instance_class_params_enabled = true;
+
+void setInstanceClassParamsEnabled(bool enabled) {
+    instance_class_params_enabled = enabled;
+}
+
+/// <summary>
+/// Состояние realSolver перед первой попыткой вставить пользователя с номером position.
+/// Зависит только от первых position пользователей порядка
+/// </summary>
+struct SolverCheckpoint {
+    int position = 0;
+    bool ready = false;
+    vector<MaskedInterval> intervals;
+    vector<pair<int, int>> user_intervals;
+    DeferredSet deferred;
+};
+
+/// <summary>
+/// План переиспользования префиксов. Порядки стратегий известны до их первого прогона, поэтому
+/// каждый прогон сохраняет снимки только в тех позициях, с которых продолжат более поздние.
+/// Снимки всех прогонов лежат в одном массиве и переиспользуются между вызовами Solver
+/// </summary>
+struct PrefixPlan {
+    // снимки прогона i - [first_checkpoint[i], first_checkpoint[i + 1]) по возрастанию позиции
+    vector<SolverCheckpoint> checkpoints;
+    vector<int> first_checkpoint;
+    // прогон-источник и позиция, с которой продолжается прогон, или -1
+    vector<pair<int, int>> resume_from;
+    // более ранний прогон с тем же порядком или -1
+    vector<int> duplicate_of;
+    // запрошенные снимки (прогон-источник, позиция)
+    vector<pair<int, int>> requests;
+
+    static int commonPrefix(const vector<UserId>& a, const vector<UserId>& b) {
+        int n = (int)min(a.size(), b.size());
+        int i = 0;
+        while (i < n && a[i] == b[i]) ++i;
+        return i;
+    }
+
+    // Использует первые count порядков, первые done из них уже выполнены без снимков
+    // и служат только источником совпадающих порядков
+    void build(const vector<vector<UserId>>& orders, int count, int min_prefix, int done = 0) {
+        resume_from.assign(count, { -1, 0 });
+        duplicate_of.assign(count, -1);
+        requests.clear();
+
+        for (int j = 1; j < count; ++j) {
+            int best_source = -1;
+            int best_prefix = 0;
+            for (int i = 0; i < j; ++i) {
+                if (duplicate_of[i] >= 0) continue;
+                int prefix = commonPrefix(orders[i], orders[j]);
+                if (i < done && prefix < (int)orders[j].size()) continue;
+                // источник должен сам пройти позицию prefix, а не начать после неё
+                if (resume_from[i].first >= 0 && resume_from[i].second > prefix) continue;
+                if (prefix > best_prefix) {
+                    best_source = i;
+                    best_prefix = prefix;
+                }
+            }
+
+            if (best_source >= 0 && best_prefix == (int)orders[j].size()) {
+                duplicate_of[j] = best_source;
+                continue;
+            }
+            if (best_source < 0 || best_prefix < min_prefix) continue;
+
+            resume_from[j] = { best_source, best_prefix };
+            requests.push_back({ best_source, best_prefix });
+        }
+
+        sort(requests.begin(), requests.end());
+        requests.erase(unique(requests.begin(), requests.end()), requests.end());
+
+        if (checkpoints.size() < requests.size()) checkpoints.resize(requests.size());
+        first_checkpoint.assign(count + 1, 0);
+        for (int k = 0; k < (int)requests.size(); ++k) {
+            checkpoints[k].position = requests[k].second;
+            checkpoints[k].ready = false;
+            ++first_checkpoint[requests[k].first + 1];
+        }
+        for (int i = 0; i < count; ++i) first_checkpoint[i + 1] += first_checkpoint[i];
+    }
+
+    SolverCheckpoint* runCheckpoints(int i) {
+        return checkpoints.data() + first_checkpoint[i];
+    }
+
+    int runCheckpointsCount(int i) const {
+        return first_checkpoint[i + 1] - first_checkpoint[i];
+    }
+
+    // Снимок, с которого продолжает прогон j, или nullptr, если источник его не сохранил
+    const SolverCheckpoint* resumePoint(int j) const {
+        int source = resume_from[j].first;
+        if (source < 0) return nullptr;
+        for (int k = first_checkpoint[source]; k < first_checkpoint[source + 1]; ++k) {
+            const SolverCheckpoint& checkpoint = checkpoints[k];
+            if (checkpoint.position == resume_from[j].second) return checkpoint.ready ? &checkpoint : nullptr;
+        }
+        return nullptr;
+    }
+};
+
+/// <summary>
+/// Рабочая память прогона realSolver, своя у каждого потока
+/// </summary>
+struct SolverWorkspace {
+    // расписание текущего прогона
+    vector<MaskedInterval> run_intervals;
+    DeferredSet deferred;
+    vector<pair<int, int>> moved_user_intervals;
+    vector<int> right_intervals;
+};
+
+thread_local SolverWorkspace solver_workspace;
+
+/// <summary>
+/// Состояние решения одного экземпляра: входные данные, порядки прогонов, план префиксов и буферы
+/// сборки ответа. Векторы только растут и переиспользуются между вызовами,
+/// поэтому после прогрева на тестах того же размера вызов не обращается к куче
+/// </summary>
+struct SolverContext {
+    int N = 0, M = 0, K = 0, J = 0, L = 0;
+    const vector<Interval>* reserved = nullptr;
+    const vector<UserInfo>* users = nullptr;
+    SolverParams params = {};
+    int max_test_score = 0;
+    // L с учётом числа различных beam
+    int max_insertions = 0;
+    // Оценка checker, выше которой не подняться: все получили rbNeed или заполнены все строки.
+    // Прогон с такой оценкой оптимален, остальные прогоны не нужны
+    float optimal_value = 0;
+    // начало подготовки, от него считается solver_time_budget_us
+    chrono::steady_clock::time_point start_time;
+    // случайные стратегии порядка, зерно задаётся при подготовке экземпляра
+    mt19937 rng;
+
+    vector<uint64_t> keys;
+    vector<UserId> user_indices;
+    // классы одинаковых (rbNeed, beam): класс пользователя, начало и следующий член класса в user_indices
+    vector<int> user_class;
+    vector<int> class_start;
+    vector<int> class_next;
+    // свободные интервалы до расстановки
+    vector<MaskedInterval> intervals;
+
+    // порядки обхода, используются первые orders_count
+    vector<vector<UserId>> orders;
+    int orders_count = 0;
+    // индекс стратегии в order_strategies, -1 для базового порядка
+    vector<int> order_strategy;
+    vector<pair<float, int>> priorities;
+    vector<int> scheduled;
+    PrefixPlan plan;
+
+    // лучшее расписание и границы его пользователей
+    vector<MaskedInterval> result;
+    vector<MaskedInterval> temp;
+    vector<pair<int, int>> actual_user_intervals;
+
+    // перераспределение пользователей по частотам
+    vector<int> user_lengths;
+    vector<UserId> inserted_users;
+    vector<UserId> users_by_beam;
+    vector<int> old2new;
+    vector<int> user_starts;
+    vector<int> user_ends;
+
+    // Результаты прогонов при пакетном решении, оценка -1 - прогон не выполнялся
+    vector<float> run_values;
+    vector<vector<MaskedInterval>> run_results;
+    vector<vector<pair<int, int>>> run_bounds;
+
+    // Добавляет копию порядка, переиспользуя память ранее выделенных
+    vector<UserId>& addOrder(const vector<UserId>& order) {
+        if ((int)orders.size() == orders_count) orders.emplace_back();
+        vector<UserId>& added = orders[orders_count++];
+        added = order;
+        return added;
+    }
+};
+
+thread_local SolverContext solver_context;
+
+/// <summary>
+/// Жадная расстановка пользователей в порядке user_infos. Возвращает false, если прогон прерван
+/// из-за нарушения инварианта, тогда result не изменяется.
+/// Если задан resume, прогон продолжается с этого снимка вместо начала порядка;
+/// в checkpoints сохраняются снимки в запрошенных позициях
+/// </summary>
+bool realSolver(int N, int M, int K, int J, int L, const vector<MaskedInterval>& reservedRBs, const vector<UserId>& user_infos, vector<MaskedInterval>& result,
+    const SolverCheckpoint* resume = nullptr, SolverCheckpoint* checkpoints = nullptr, int checkpoints_count = 0);
+
+// Сдвигает общие границы соседних интервалов, пока это увеличивает заполнение
+inline void moveBounds(vector<MaskedInterval>& result, vector<pair<int, int>>& actual_user_intervals) {
+    SolverWorkspace& workspace = solver_workspace;
+    int max_iterations = 50;
+    while (max_iterations--) {
+        StepStatus status = move_bounds_left(result, actual_user_intervals);
+        if (status == STEP_SKIPPED) status = move_bounds_right(result, actual_user_intervals, workspace.moved_user_intervals, workspace.right_intervals);
+        if (status != STEP_DONE) break;
+    }
+}
+
+// Параметры и таблица пользователей экземпляра в текущем потоке
+inline void loadSolverInstance(const SolverContext& context) {
+    applySolverParams(context.params);
+    user_table.assign(*context.users);
+    replace_memo.resize((int)context.users->size());
+}
+
+// Приведение порядков к каноническому виду по классам одинаковых пользователей. Выключено:
+// на open.txt и сгенерированных наборах с повторами совпавших порядков не нашлось, а проход
+// стоит O(N) на порядок и меняет ответ при равных вкладах (realSolver различает пользователей по id)
+bool symmetry_reduction_enabled = false;
+
+void setSymmetryReductionEnabled(bool enabled) {
+    symmetry_reduction_enabled = enabled;
+}
+
+/// <summary>
+/// Пользователи с одинаковыми (rbNeed, beam) взаимозаменяемы, порядки, различающиеся только их
+/// перестановкой, дают одно расписание с точностью до имён. Каждый порядок приводится к виду,
+/// где члены класса идут в порядке user_indices: k-е появление класса получает его k-го члена.
+/// Совпавшие после этого порядки план префиксов отмечает дубликатами, и они не прогоняются
+/// </summary>
+inline void canonicalizeOrders(SolverContext& context) {
+    const vector<UserId>& userIndices = context.user_indices;
+    const LocalArray<uint64_t>& orderKey = user_table.order_key;
+    int N = (int)userIndices.size();
+
+    // в user_indices класс - отрезок подряд идущих пользователей с одинаковым ключом без id
+    vector<int>& userClass = context.user_class;
+    vector<int>& classStart = context.class_start;
+    userClass.resize(N);
+    classStart.clear();
+    for (int i = 0; i < N; ++i) {
+        if (i == 0 || orderKey[userIndices[i]] >> 16 != orderKey[userIndices[i - 1]] >> 16) classStart.push_back(i);
+        userClass[userIndices[i]] = (int)classStart.size() - 1;
+    }
+    if ((int)classStart.size() == N) return;
+
+    vector<int>& classNext = context.class_next;
+    // базовый порядок уже в каноническом виде
+    for (int k = 1; k < context.orders_count; ++k) {
+        classNext.assign(classStart.begin(), classStart.end());
+        for (UserId& u : context.orders[k]) u = userIndices[classNext[userClass[u]]++];
+    }
+}
+
+/// <summary>
+/// Подготовка экземпляра: параметры класса, порядок пользователей, свободные интервалы,
+/// порядки всех прогонов и план продолжения с общих префиксов не короче min_prefix.
+/// Случайные порядки зависят только от seed. Возвращает false, если свободных блоков нет:
+/// тогда прогонов нет и ответ пустой
+/// </summary>
+inline bool prepareSolverRuns(SolverContext& context, int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos,
+    unsigned int seed) {
+
+    context.start_time = chrono::steady_clock::now();
+    context.rng.seed(seed);
+    context.N = N;
+    context.M = M;
+    context.K = K;
+    context.J = J;
+    context.L = L;
+    context.reserved = &reservedRBs;
+    context.users = &userInfos;
+    context.orders_count = 0;
+
+    getNonReservedIntervals(reservedRBs, M, context.intervals);
+    if (context.intervals.empty()) return false;
+    sort(context.intervals.begin(), context.intervals.end(), sortIntervalsDescendingComp);
+
+    context.params = instance_class_params_enabled ? instance_class_params[getInstanceClass(M, J, L, reservedRBs, userInfos)] : default_solver_params;
+
+    loadSolverInstance(context);
+    context.max_test_score = getMaxTestScore(M, L, reservedRBs);
+
+    vector<uint64_t>& keys = context.keys;
+    vector<UserId>& userIndices = context.user_indices;
+    keys.resize(N);
+    for (int i = 0; i < N; ++i) keys[i] = user_table.order_key[userInfos[i].id];
+    sortIdsByPackedKeys(keys, userIndices);
+
+    uint32_t beams = 0;
+    long long total_need = 0;
+    for (const auto& user : userInfos) {
+        beams |= 1u << user.beam;
+        total_need += user.rbNeed;
+    }
+    context.max_insertions = min(L, (int)bitset<32>(beams).count());
+    // то же вычисление, что в checker, чтобы оценки совпадали точно
+    int capacity = context.max_test_score * context.max_insertions;
+    context.optimal_value = capacity > 0 ? min(total_need, (long long)capacity) * 100.0f / (float)capacity : 0.0f;
+
+    // Просчёт с просто отсортированными отрезками. Порядки стратегий строит addStrategyRuns,
+    // только если базовый прогон не достиг optimal_value
+    context.order_strategy.clear();
+    context.addOrder(userIndices);
+    context.order_strategy.push_back(-1);
+    context.plan.build(context.orders, context.orders_count, INT_MAX);
+    return true;
+}
+
+/// <summary>
+/// Добавление порядков стратегий после выполненного базового прогона и план префиксов для них:
+/// прогоны с общим префиксом продолжают со снимка более раннего прогона стратегии,
+/// совпадающие порядки (в том числе с базовым) пропускаются
+/// </summary>
+inline void addStrategyRuns(SolverContext& context, int min_prefix) {
+    bool random_enable = true;
+
+    const vector<UserId>& userIndices = context.user_indices;
+    vector<int>& order_strategy = context.order_strategy;
+
+    scheduleOrderStrategies(random_enable, context.priorities, context.scheduled);
+    for (int index : context.scheduled) {
+        const OrderStrategy& strategy = order_strategies[index];
+        strategy.apply(context.addOrder(userIndices), strategy.param, context.rng);
+        order_strategy.push_back(index);
+    }
+    if (symmetry_reduction_enabled) canonicalizeOrders(context);
+
+    context.plan.build(context.orders, context.orders_count, min_prefix, 1);
+}
+
+inline bool isSolverTimeBudgetExceeded(const SolverContext& context) {
+    return solver_time_budget_us > 0 &&
+        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - context.start_time).count() >= solver_time_budget_us;
+}
+
+/// <summary>
+/// Сборка ответа из лучшего расписания context.result с границами пользователей
+/// context.actual_user_intervals: сдвиг границ, перераспределение пользователей по частотам,
+/// запись до J интервалов в answer. Интервалы answer и их списки пользователей переиспользуются
+/// </summary>
+inline void finishSolution(SolverContext& context, vector<Interval>& answer) {
+    int N = context.N;
+    int J = context.J;
+    vector<MaskedInterval>& result = context.result;
+    vector<pair<int, int>>& actual_user_intervals = context.actual_user_intervals;
+    vector<uint64_t>& keys = context.keys;
+
+    sort(result.begin(), result.end(), [](const MaskedInterval& l, const MaskedInterval& r) { return l.start < r.start; });
+    moveBounds(result, actual_user_intervals);
+
+    // перераспределение пользователей по частотам
+    {
+        vector<int>& userLengths = context.user_lengths;
+        vector<UserId>& insertedUsers = context.inserted_users;
+        userLengths.assign(N, 0);
+        insertedUsers.clear();
+
+        for (const auto& interval : result) {
+            for (auto u : interval.users) {
+                if (userLengths[u] == 0) insertedUsers.push_back(u);
+                userLengths[u] += interval.end - interval.start;
+            }
+        }
+
+        // beam по возрастанию, затем выданная длина по убыванию
+        keys.resize(insertedUsers.size());
+        for (int i = 0; i < (int)insertedUsers.size(); ++i) {
+            int u = insertedUsers[i];
+            keys[i] = packUserKey(0xFFFF - user_table.beam[u], userLengths[u], u);
+        }
+        sortIdsByPackedKeys(keys, insertedUsers);
+
+        // beam по возрастанию, затем rbNeed по убыванию
+        vector<UserId>& usersByBeam = context.users_by_beam;
+        keys.resize(N);
+        for (int i = 0; i < N; ++i) keys[i] = packUserKey(0xFFFF - user_table.beam[i], user_table.rbNeed[i], i);
+        sortIdsByPackedKeys(keys, usersByBeam);
+
+        vector<int>& old2new = context.old2new;
+        old2new.assign(N, -1);
+        int indexNew = 0;
+        for (int i = 0; i < insertedUsers.size(); ++i, ++indexNew) {
+            while (user_table.beam[usersByBeam[indexNew]] != user_table.beam[insertedUsers[i]]) ++indexNew;
+
+            old2new[insertedUsers[i]] = usersByBeam[indexNew];
+        }
+
+        for (auto& interval : result) {
+            for (auto& u : interval.users) {
+                u = old2new[u];
+            }
+        }
+
+        actual_user_intervals.assign(N, { -1,-1 });
+        vector<int>& userStarts = context.user_starts;
+        vector<int>& userEnds = context.user_ends;
+        userStarts.assign(N, -1);
+        userEnds.assign(N, -1);
+        for (const auto& interval : result) {
+            for (auto u : interval.users) {
+                if (userStarts[u] == -1) userStarts[u] = interval.start;
+                userEnds[u] = interval.end;
+            }
+        }
+        for (int i = 0; i < N; ++i) {
+            if (userStarts[i] == -1) continue;
+            actual_user_intervals[i] = { userStarts[i], min(userEnds[i], userStarts[i] + user_table.rbNeed[i]) };
+        }
+    }
+    moveBounds(result, actual_user_intervals);
+
+    // Формируем ответ
+    int j = 0;
+    for (int i = 0; j < J && i < result.size(); ++i) {
+        if (result[i].users.size() > 0) {
+            if ((int)answer.size() == j) answer.emplace_back();
+            Interval& interval = answer[j++];
+            interval.start = result[i].start;
+            interval.end = result[i].end;
+            interval.users.assign(result[i].users.begin(), result[i].users.end());
+        }
+    }
+
+    while (answer.size() > j) {
+        answer.pop_back();
+    }
+
+    CHECK_ANSWER(answer, context.M, J, context.L, *context.reserved);
+}
+
+// Формат журнала захвата, разбирает readCaptureLog из TestCase.h.
+// Файл: "SCAP", uint16 версия. Запись: uint32 длина остатка записи, uint16 N, uint32 M, uint16 K, J, L,
+// K раз uint32 start, end, N раз uint32 rbNeed, uint8 beam, uint16 id, float задержка в мкс,
+// uint16 число интервалов ответа, для каждого uint32 start, end, uint8 число пользователей, uint16 пользователи
+const uint16_t SOLVER_CAPTURE_VERSION = 1;
+
+/// <summary>
+/// Захват входов Solver с ответом и задержкой в двоичный журнал для воспроизведения вне продакшена.
+/// Решающие потоки не ждут записи: запись кодируется в слот ограниченной очереди без блокировок
+/// (номер последовательности на слот), файл пишет отдельный поток. Если очередь полна, запись
+/// отбрасывается и учитывается в dropped
+/// </summary>
+struct SolverCapture {
+    static const int SLOTS = 1024;
+
+    struct Slot {
+        atomic<size_t> sequence{ 0 };
+        vector<uint8_t> bytes;
+    };
+
+    atomic<bool> enabled{ false };
+    // решающие потоки, которые сейчас кладут запись
+    atomic<int> producers{ 0 };
+    atomic<size_t> head{ 0 };
+    atomic<uint64_t> captured{ 0 };
+    atomic<uint64_t> dropped{ 0 };
+    unique_ptr<Slot[]> slots;
+
+    // состояние потока записи
+    size_t tail = 0;
+    FILE* file = nullptr;
+    thread writer;
+    atomic<bool> stopping{ false };
+
+    // Слот, который записывает поток записи, или nullptr, если очередь пуста
+    Slot* front() {
+        Slot& slot = slots[tail % SLOTS];
+        return slot.sequence.load(memory_order_acquire) == tail + 1 ? &slot : nullptr;
+    }
+
+    void release(Slot& slot) {
+        slot.sequence.store(tail + SLOTS, memory_order_release);
+        ++tail;
+    }
+
+    SolverCapture() = default;
+    SolverCapture(const SolverCapture&) = delete;
+    SolverCapture& operator=(const SolverCapture&) = delete;
+
+    // журнал дописывается и при выходе из программы без stopSolverCapture
+    ~SolverCapture() {
+        stop();
+    }
+
+    bool start(const char* path);
+
+    void stop() {
+        if (file == nullptr) return;
+
+        enabled.store(false, memory_order_seq_cst);
+        while (producers.load(memory_order_seq_cst) > 0) this_thread::yield();
+        stopping.store(true, memory_order_release);
+        writer.join();
+
+        fclose(file);
+        file = nullptr;
+    }
+
+    void writerLoop() {
+        while (true) {
+            Slot* slot = front();
+            if (slot != nullptr) {
+                fwrite(slot->bytes.data(), 1, slot->bytes.size(), file);
+                release(*slot);
+                continue;
+            }
+            // остановка объявляется после ухода всех производителей, пустая очередь значит конец
+            if (stopping.load(memory_order_acquire)) break;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        fflush(file);
+    }
+};
+
+SolverCapture solver_capture;
+
+inline void putCapture8(vector<uint8_t>& bytes, uint8_t value) {
+    bytes.push_back(value);
+}
+
+inline void putCapture16(vector<uint8_t>& bytes, uint16_t value) {
+    bytes.push_back((uint8_t)value);
+    bytes.push_back((uint8_t)(value >> 8));
+}
+
+inline void putCapture32(vector<uint8_t>& bytes, uint32_t value) {
+    putCapture16(bytes, (uint16_t)value);
+    putCapture16(bytes, (uint16_t)(value >> 16));
+}
+
+/// <summary>
+/// Включает захват в файл path, журнал перезаписывается. Возвращает false, если файл не открылся
+/// </summary>
+inline bool SolverCapture::start(const char* path) {
+    stop();
+
+    file = fopen(path, "wb");
+    if (file == nullptr) return false;
+    vector<uint8_t> header = { 'S', 'C', 'A', 'P' };
+    putCapture16(header, SOLVER_CAPTURE_VERSION);
+    fwrite(header.data(), 1, header.size(), file);
+
+    if (slots == nullptr) slots.reset(new Slot[SLOTS]);
+    for (int i = 0; i < SLOTS; ++i) slots[i].sequence.store(i, memory_order_relaxed);
+    head = 0;
+    tail = 0;
+    captured = 0;
+    dropped = 0;
+    stopping = false;
+    writer = thread(&SolverCapture::writerLoop, this);
+    enabled.store(true, memory_order_release);
+    return true;
+}
+
+inline bool startSolverCapture(const char* path) {
+    return solver_capture.start(path);
+}
+
+// Выключает захват, дописывает поставленные в очередь записи и закрывает файл
+inline void stopSolverCapture() {
+    solver_capture.stop();
+}
+
+inline bool isSolverCaptureEnabled() {
+    return solver_capture.enabled.load(memory_order_relaxed);
+}
+
+/// <summary>
+/// Кладёт экземпляр, его ответ и задержку в очередь захвата. Не блокируется
+/// </summary>
+inline void captureInstance(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos,
+    const vector<Interval>& answer, double latency_us) {
+    SolverCapture& capture = solver_capture;
+
+    // производитель объявляет себя до повторной проверки, stopSolverCapture дождётся его
+    capture.producers.fetch_add(1, memory_order_seq_cst);
+    if (!capture.enabled.load(memory_order_seq_cst)) {
+        capture.producers.fetch_sub(1, memory_order_release);
+        return;
+    }
+
+    SolverCapture::Slot* slot = nullptr;
+    size_t position = capture.head.load(memory_order_relaxed);
+    while (true) {
+        SolverCapture::Slot& candidate = capture.slots[position % SolverCapture::SLOTS];
+        size_t sequence = candidate.sequence.load(memory_order_acquire);
+        if (sequence == position) {
+            if (capture.head.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                slot = &candidate;
+                break;
+            }
+        }
+        else if (sequence < position) {
+            // слот ещё не записан на диск: очередь полна
+            break;
+        }
+        else {
+            position = capture.head.load(memory_order_relaxed);
+        }
+    }
+
+    if (slot != nullptr) {
+        vector<uint8_t>& bytes = slot->bytes;
+        bytes.clear();
+        putCapture32(bytes, 0);
+        putCapture16(bytes, (uint16_t)N);
+        putCapture32(bytes, (uint32_t)M);
+        putCapture16(bytes, (uint16_t)K);
+        putCapture16(bytes, (uint16_t)J);
+        putCapture16(bytes, (uint16_t)L);
+        for (const auto& reserved : reservedRBs) {
+            putCapture32(bytes, (uint32_t)reserved.start);
+            putCapture32(bytes, (uint32_t)reserved.end);
+        }
+        for (const auto& user : userInfos) {
+            putCapture32(bytes, (uint32_t)user.rbNeed);
+            putCapture8(bytes, (uint8_t)user.beam);
+            putCapture16(bytes, (uint16_t)user.id);
+        }
+        float latency = (float)latency_us;
+        uint32_t latency_bits;
+        memcpy(&latency_bits, &latency, sizeof(latency_bits));
+        putCapture32(bytes, latency_bits);
+        putCapture16(bytes, (uint16_t)answer.size());
+        for (const auto& interval : answer) {
+            putCapture32(bytes, (uint32_t)interval.start);
+            putCapture32(bytes, (uint32_t)interval.end);
+            putCapture8(bytes, (uint8_t)interval.users.size());
+            for (int u : interval.users) putCapture16(bytes, (uint16_t)u);
+        }
+        uint32_t length = (uint32_t)bytes.size() - 4;
+        for (int i = 0; i < 4; ++i) bytes[i] = (uint8_t)(length >> (8 * i));
+
+        slot->sequence.store(position + 1, memory_order_release);
+        ++capture.captured;
+    }
+    else {
+        ++capture.dropped;
+    }
+
+    capture.producers.fetch_sub(1, memory_order_release);
+}
+
+// Снимок счётчиков выделений текущего потока. Solution.h не подменяет operator new,
+// счётчики ведёт исполняемый файл, например MemoryCounter.h (sampleThreadMemory<MemorySample>)
+struct MemorySample {
+    size_t allocations = 0;
+    size_t bytes = 0;
+    long long live_bytes = 0;
+    long long peak_bytes = 0;
+};
+
+// reset_peak - начать пик заново от текущего объёма
+typedef void (*MemorySampler)(MemorySample& sample, bool reset_peak);
+
+// Фазы вызова Solver для профиля памяти
+enum SolverMemoryPhase {
+    MEMORY_PREPARE,     // порядки прогонов, план префиксов; при J = 1 всё решение
+    MEMORY_RUNS,        // прогоны realSolver
+    MEMORY_FINISH,      // сборка ответа
+    MEMORY_PHASES
+};
+
+// peak_bytes - пик живых байт сверх объёма на начало фазы или вызова
+struct PhaseMemory {
+    size_t allocations = 0;
+    size_t bytes = 0;
+    long long peak_bytes = 0;
+};
+
+struct SolverMemoryStats {
+    PhaseMemory call;
+    PhaseMemory phases[MEMORY_PHASES];
+};
+
+/// <summary>
+/// Сводка по вызовам с профилем: суммы выделений и байт, наибольшие пики по вызову и фазам
+/// </summary>
+struct SolverMemoryTotals {
+    size_t calls = 0;
+    SolverMemoryStats sum;
+    SolverMemoryStats max;
+};
+
+// Профиль памяти вызовов SolverInto, выключен при nullptr
+MemorySampler solver_memory_sampler = nullptr;
+
+mutex solver_memory_mutex;
+SolverMemoryTotals solver_memory_totals;
+
+struct SolverMemoryProfile {
+    int phase = -1;
+    MemorySample call_start;
+    MemorySample phase_start;
+    SolverMemoryStats stats;
+};
+
+thread_local SolverMemoryProfile solver_memory_profile;
+
+/// <summary>
+/// Включает профиль памяти: каждый вызов SolverInto снимает счётчики потока на границах фаз.
+/// nullptr выключает. Вызывать, пока Solver не работает в других потоках
+/// </summary>
+inline void setSolverMemorySampler(MemorySampler sampler) {
+    solver_memory_sampler = sampler;
+}
+
+inline void resetSolverMemoryTotals() {
+    lock_guard<mutex> lock(solver_memory_mutex);
+    solver_memory_totals = SolverMemoryTotals();
+}
+
+inline SolverMemoryTotals getSolverMemoryTotals() {
+    lock_guard<mutex> lock(solver_memory_mutex);
+    return solver_memory_totals;
+}
+
+// Профиль последнего вызова SolverInto в этом потоке
+inline const SolverMemoryStats& getLastSolverMemoryStats() {
+    return solver_memory_profile.stats;
+}
+
+inline void endMemoryPhase(SolverMemoryProfile& profile) {
+    if (profile.phase < 0) return;
+    MemorySample now;
+    solver_memory_sampler(now, false);
+    PhaseMemory& phase = profile.stats.phases[profile.phase];
+    phase.allocations = now.allocations - profile.phase_start.allocations;
+    phase.bytes = now.bytes - profile.phase_start.bytes;
+    phase.peak_bytes = now.peak_bytes - profile.phase_start.live_bytes;
+
+    // пик фазы от её начала плюс прирост с начала вызова до фазы
+    long long call_peak = profile.phase_start.live_bytes - profile.call_start.live_bytes + phase.peak_bytes;
+    profile.stats.call.peak_bytes = max(profile.stats.call.peak_bytes, call_peak);
+}
+
+inline void beginMemoryPhase(int phase) {
+    if (solver_memory_sampler == nullptr) return;
+    SolverMemoryProfile& profile = solver_memory_profile;
+    endMemoryPhase(profile);
+    if (phase == MEMORY_PREPARE) {
+        profile.stats = SolverMemoryStats();
+        solver_memory_sampler(profile.call_start, true);
+    }
+    solver_memory_sampler(profile.phase_start, true);
+    profile.phase = phase;
+}
+
+inline void endMemoryCall() {
+    if (solver_memory_sampler == nullptr) return;
+    SolverMemoryProfile& profile = solver_memory_profile;
+    endMemoryPhase(profile);
+    profile.phase = -1;
+
+    MemorySample now;
+    solver_memory_sampler(now, false);
+    SolverMemoryStats& stats = profile.stats;
+    stats.call.allocations = now.allocations - profile.call_start.allocations;
+    stats.call.bytes = now.bytes - profile.call_start.bytes;
+
+    lock_guard<mutex> lock(solver_memory_mutex);
+    SolverMemoryTotals& totals = solver_memory_totals;
+    ++totals.calls;
+    auto add = [](PhaseMemory& sum, PhaseMemory& maximum, const PhaseMemory& value) {
+        sum.allocations += value.allocations;
+        sum.bytes += value.bytes;
+        sum.peak_bytes += value.peak_bytes;
+        maximum.allocations = max(maximum.allocations, value.allocations);
+        maximum.bytes = max(maximum.bytes, value.bytes);
+        maximum.peak_bytes = max(maximum.peak_bytes, value.peak_bytes);
+    };
+    add(totals.sum.call, totals.max.call, stats.call);
+    for (int i = 0; i < MEMORY_PHASES; ++i) add(totals.sum.phases[i], totals.max.phases[i], stats.phases[i]);
+}
+
+/// <summary>
+/// Точное решение при J = 1. Ответ - один интервал, выгоднее всего самый длинный свободный отрезок.
+/// На каждый beam берётся пользователь с наибольшим min(rbNeed, длина), из них L лучших
+/// </summary>
+inline void solveSingleInterval(SolverContext& context, int M, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos, vector<Interval>& answer) {
+    vector<MaskedInterval>& free_intervals = context.intervals;
+    getNonReservedIntervals(reservedRBs, M, free_intervals);
+    if (free_intervals.empty()) {
+        answer.clear();
+        CHECK_ANSWER(answer, M, 1, L, reservedRBs);
+        return;
+    }
+
+    int longest = -1;
+    for (int i = 0; i < (int)free_intervals.size(); ++i) {
+        if (longest == -1 || free_intervals[i].getLength() > free_intervals[longest].getLength()) longest = i;
+    }
+
+    int beam_best[32];
+    fill(beam_best, beam_best + 32, -1);
+    int length = free_intervals[longest].getLength();
+    for (int i = 0; i < (int)userInfos.size(); ++i) {
+        int& best = beam_best[userInfos[i].beam];
+        if (best == -1 || min(userInfos[i].rbNeed, length) > min(userInfos[best].rbNeed, length)) best = i;
+    }
+
+    // выгода по убыванию
+    vector<uint64_t>& keys = context.keys;
+    keys.clear();
+    for (int beam = 0; beam < 32; ++beam) {
+        if (beam_best[beam] >= 0) keys.push_back(packUserKey(0, min(userInfos[beam_best[beam]].rbNeed, length), beam_best[beam]));
+    }
+    sort(keys.begin(), keys.end(), greater<uint64_t>());
+
+    if (keys.empty() || L <= 0) {
+        answer.clear();
+        return;
+    }
+
+    answer.resize(1);
+    answer[0].start = free_intervals[longest].start;
+    answer[0].end = free_intervals[longest].end;
+    answer[0].users.clear();
+    for (int i = 0; i < (int)keys.size() && i < L; ++i) answer[0].users.push_back(userInfos[keys[i] & 0xFFFF].id);
+
+#ifdef SOLVER_CHECK_INVARIANTS
+    user_table.assign(userInfos);
+    CHECK_ANSWER(answer, M, 1, L, reservedRBs);
+#endif
+}
+
+// Решение без захвата: J = 1 точно, иначе лучший из прогонов порядков
+inline void solveInstance(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos, vector<Interval>& answer,
+    unsigned int seed) {
+
+    SolverContext& context = solver_context;
+    beginMemoryPhase(MEMORY_PREPARE);
+
+    if (J == 1) {
+        solveSingleInterval(context, M, L, reservedRBs, userInfos, answer);
+        endMemoryCall();
+        return;
+    }
+
+    // все блоки зарезервированы - ставить некуда
+    if (!prepareSolverRuns(context, N, M, K, J, L, reservedRBs, userInfos, seed)) {
+        answer.clear();
+        CHECK_ANSWER(answer, M, J, L, reservedRBs);
+        endMemoryCall();
+        return;
+    }
+
+    TRACE_TEST(N, M, J, L);
+    const PrefixPlan& plan = context.plan;
+    int maxInsertions = context.max_insertions;
+
+    int best_test_index = 1;
+
+    float best_value = 0;
+    float base_value = 0;
+    float curr_value = 0;
+
+    beginMemoryPhase(MEMORY_RUNS);
+    for (int i = 0; i < context.orders_count; ++i) {
+        if (i > 0 && isSolverTimeBudgetExceeded(context)) break;
+
+        // Тот же порядок даст ту же оценку и не станет лучше
+        if (plan.duplicate_of[i] >= 0) continue;
+
+        TRACE_RUN(context.order_strategy[i]);
+        // Прерванный прогон получает оценку 0 и не может стать лучшим
+        curr_value = realSolver(N, M, K, J, maxInsertions, context.intervals, context.orders[i], context.temp, plan.resumePoint(i), context.plan.runCheckpoints(i), plan.runCheckpointsCount(i)) ?
+            checker(N, M, K, J, maxInsertions, context.max_test_score) : 0;
+        TRACE_RUN_END(curr_value);
+
+        if (i == 0) base_value = curr_value;
+        else recordStrategyRun(context.order_strategy[i], curr_value, base_value);
+
+        if (i == 0 || curr_value > best_value) {
+            best_test_index = i == 0 ? 1 : order_strategies[context.order_strategy[i]].test_index;
+            best_value = curr_value;
+            context.result = context.temp;
+            context.actual_user_intervals.assign(user_intervals.begin(), user_intervals.end());
+        }
+
+        if (best_value >= context.optimal_value) break;
+        if (i == 0) addStrategyRuns(context, min_checkpoint_prefix);
+    }
+
+    recordBestTestIndex(best_test_index);
+    beginMemoryPhase(MEMORY_FINISH);
+    finishSolution(context, answer);
+    endMemoryCall();
+}
+
+/// <summary>
+/// Функция решения задачи, ответ записывается в answer. Память answer и рабочих буферов
+/// переиспользуется, при повторных вызовах на тестах того же размера выделений нет.
+/// Состояние вызова своё у каждого потока, вызовы из разных потоков независимы.
+/// При включённом захвате (startSolverCapture) вход, ответ и задержка попадают в журнал,
+/// при заданном setSolverMemorySampler - профиль памяти по фазам
+/// </summary>
+/// <param name="N">Количество пользователей</param>
+/// <param name="M">Количество блоков передачи данных</param>
+/// <param name="K">Количество зарезервированных интервалов передачи данных</param>
+/// <param name="J">Максимальное количество интервалов с пользователями</param>
+/// <param name="L">Максимальное количество пользователей на одном интервале</param>
+/// <param name="reservedRBs">Зарезервированные интервалы</param>
+/// <param name="userInfos">Информация о пользователях</param>
+/// <param name="answer">Интервалы передачи данных, до J штук</param>
+void SolverInto(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos, vector<Interval>& answer) {
+    if (!isSolverCaptureEnabled()) {
+        solveInstance(N, M, K, J, L, reservedRBs, userInfos, answer, getSolverSeed());
+        return;
+    }
+
+    auto start_time = chrono::steady_clock::now();
+    solveInstance(N, M, K, J, L, reservedRBs, userInfos, answer, getSolverSeed());
+    double latency_us = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_time).count() / 1000.0;
+    captureInstance(N, M, K, J, L, reservedRBs, userInfos, answer, latency_us);
+}
+
+/// <summary>
+/// Функция решения задачи
+/// </summary>
+/// <param name="N">Количество пользователей</param>
+/// <param name="M">Количество блоков передачи данных</param>
+/// <param name="K">Количество зарезервированных интервалов передачи данных</param>
+/// <param name="J">Максимальное количество интервалов с пользователями</param>
+/// <param name="L">Максимальное количество пользователей на одном интервале</param>
+/// <param name="reservedRBs">Зарезервированные интервалы</param>
+/// <param name="userInfos">Информация о пользователях</param>
+/// <returns>Интервалы передачи данных, до J штук</returns>
+vector<Interval> Solver(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos) {
+    vector<Interval> answer;
+    SolverInto(N, M, K, J, L, reservedRBs, userInfos, answer);
+    return answer;
+}
+
+/// <summary>
+/// Экземпляр пакетного решения. Входные данные должны жить до конца BatchSolver::solve
+/// </summary>
+struct SolverTask {
+    int N, M, K, J, L;
+    const vector<Interval>* reserved;
+    const vector<UserInfo>* users;
+};
+
+/// <summary>
+/// Пропускная способность и задержки пакета. Задержка экземпляра - от начала его подготовки
+/// до записи ответа
+/// </summary>
+struct BatchStats {
+    int cells = 0;
+    int threads = 0;
+    double seconds = 0;
+    double cells_per_second = 0;
+    double latency_p50_us = 0;
+    double latency_p95_us = 0;
+    double latency_p99_us = 0;
+    double latency_max_us = 0;
+};
+
+/// <summary>
+/// Пакетное решение на пуле потоков с перехватом работы. Задача - подготовка экземпляра или
+/// один прогон его порядка. Подготовка кладёт прогоны в очередь своего потока, свободный поток
+/// забирает задачи с другого конца чужой очереди, поэтому крупные и мелкие экземпляры выравниваются.
+/// Ответ собирает поток, завершивший последний прогон экземпляра.
+/// Прогоны одного экземпляра не ждут друг друга, поэтому снимки префиксов здесь не используются
+/// </summary>
+struct BatchSolver {
+    // run == -1 - подготовка экземпляра
+    struct Task {
+        int cell;
+        int run;
+    };
+
+    struct WorkQueue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    int threads_count = 1;
+    // поток 0 - вызывающий solve
+    vector<thread> workers;
+    unique_ptr<WorkQueue[]> queues;
+
+    // состояние экземпляров переиспользуется между пакетами
+    vector<SolverContext> cells;
+    unique_ptr<atomic<int>[]> pending_runs;
+    // прогон экземпляра достиг optimal_value, ещё не начатые прогоны пропускаются
+    unique_ptr<atomic<bool>[]> optimal_found;
+    int pending_capacity = 0;
+    vector<double> latencies;
+
+    const SolverTask* tasks = nullptr;
+    vector<vector<Interval>>* answers = nullptr;
+    // зерно пакета, экземпляр получает getInstanceSeed(seed, index)
+    unsigned int seed = 0;
+    atomic<int> remaining_cells{ 0 };
+    atomic<int> busy_workers{ 0 };
+
+    mutex wake_lock;
+    condition_variable wake;
+    int generation = 0;
+    bool stopping = false;
+
+    // threads = 0 - по числу ядер
+    explicit BatchSolver(int threads = 0) {
+        threads_count = threads > 0 ? threads : max(1, (int)thread::hardware_concurrency());
+        queues.reset(new WorkQueue[threads_count]);
+        for (int i = 1; i < threads_count; ++i) workers.emplace_back(&BatchSolver::workerLoop, this, i);
+    }
+
+    ~BatchSolver() {
+        {
+            lock_guard<mutex> lock(wake_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    BatchSolver(const BatchSolver&) = delete;
+    BatchSolver& operator=(const BatchSolver&) = delete;
+
+    /// <summary>
+    /// Решает все экземпляры batch, ответ экземпляра i записывается в answers[i]
+    /// </summary>
+    void solve(const vector<SolverTask>& batch, vector<vector<Interval>>& output, BatchStats* stats = nullptr) {
+        int count = (int)batch.size();
+        if ((int)output.size() < count) output.resize(count);
+        if ((int)cells.size() < count) cells.resize(count);
+        if (pending_capacity < count) {
+            pending_runs.reset(new atomic<int>[count]);
+            optimal_found.reset(new atomic<bool>[count]);
+            pending_capacity = count;
+        }
+        latencies.resize(count);
+
+        tasks = batch.data();
+        answers = &output;
+        remaining_cells = count;
+
+        seed = getSolverSeed();
+
+        // подготовки по очереди раздаются потокам
+        for (int i = 0; i < count; ++i) queues[i % threads_count].tasks.push_back({ i, -1 });
+
+        auto start_time = chrono::steady_clock::now();
+        {
+            lock_guard<mutex> lock(wake_lock);
+            busy_workers = threads_count - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(0);
+        while (busy_workers > 0) this_thread::yield();
+
+        double seconds = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_time).count() / 1e9;
+        if (stats != nullptr) fillStats(*stats, count, seconds);
+    }
+
+    void workerLoop(int index) {
+        int seen_generation = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(wake_lock);
+                wake.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) return;
+                seen_generation = generation;
+            }
+            work(index);
+            --busy_workers;
+        }
+    }
+
+    void work(int index) {
+        Task task;
+        while (remaining_cells > 0) {
+            if (popTask(index, task) || stealTask(index, task)) runTask(index, task);
+            else this_thread::yield();
+        }
+    }
+
+    // Свой поток берёт последнюю задачу: прогоны только что подготовленного экземпляра
+    bool popTask(int index, Task& task) {
+        WorkQueue& queue = queues[index];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.tasks.empty()) return false;
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    // Чужая очередь отдаёт самую старую задачу
+    bool stealTask(int index, Task& task) {
+        for (int k = 1; k < threads_count; ++k) {
+            WorkQueue& queue = queues[(index + k) % threads_count];
+            lock_guard<mutex> lock(queue.lock);
+            if (queue.tasks.empty()) continue;
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void runTask(int index, const Task& task) {
+        SolverContext& cell = cells[task.cell];
+
+        if (task.run < 0) {
+            const SolverTask& input = tasks[task.cell];
+            if (input.J == 1) {
+                cell.start_time = chrono::steady_clock::now();
+                solveSingleInterval(cell, input.M, input.L, *input.reserved, *input.users, (*answers)[task.cell]);
+                finishLatency(task.cell);
+                return;
+            }
+
+            if (!prepareSolverRuns(cell, input.N, input.M, input.K, input.J, input.L, *input.reserved, *input.users, getInstanceSeed(seed, task.cell))) {
+                (*answers)[task.cell].clear();
+                finishLatency(task.cell);
+                return;
+            }
+
+            cell.run_values.assign(1, -1.0f);
+            if (cell.run_results.empty()) cell.run_results.resize(1);
+            if (cell.run_bounds.empty()) cell.run_bounds.resize(1);
+            pending_runs[task.cell] = 1;
+            optimal_found[task.cell] = false;
+
+            WorkQueue& queue = queues[index];
+            lock_guard<mutex> lock(queue.lock);
+            queue.tasks.push_back({ task.cell, 0 });
+            return;
+        }
+
+        loadSolverInstance(cell);
+        float value = -1.0f;
+        if (task.run == 0 || (!optimal_found[task.cell] && !isSolverTimeBudgetExceeded(cell))) {
+            value = realSolver(cell.N, cell.M, cell.K, cell.J, cell.max_insertions, cell.intervals, cell.orders[task.run], cell.run_results[task.run]) ?
+                checker(cell.N, cell.M, cell.K, cell.J, cell.max_insertions, cell.max_test_score) : 0;
+            cell.run_bounds[task.run].assign(user_intervals.begin(), user_intervals.end());
+            if (value >= cell.optimal_value) optimal_found[task.cell] = true;
+        }
+        cell.run_values[task.run] = value;
+
+        if (task.run == 0 && !optimal_found[task.cell] && !isSolverTimeBudgetExceeded(cell)) queueStrategyRuns(index, task.cell);
+        if (--pending_runs[task.cell] == 0) finishCell(task.cell);
+    }
+
+    // Прогоны стратегий ставятся в очередь после базового, если тот не достиг optimal_value.
+    // Счётчик увеличивается до уменьшения за базовый прогон, и экземпляр не завершается раньше времени
+    void queueStrategyRuns(int index, int cell_index) {
+        SolverContext& cell = cells[cell_index];
+        addStrategyRuns(cell, INT_MAX);
+
+        int runs = cell.orders_count;
+        cell.run_values.resize(runs, -1.0f);
+        if ((int)cell.run_results.size() < runs) cell.run_results.resize(runs);
+        if ((int)cell.run_bounds.size() < runs) cell.run_bounds.resize(runs);
+
+        int scheduled_runs = 0;
+        for (int i = 1; i < runs; ++i) scheduled_runs += cell.plan.duplicate_of[i] < 0;
+        pending_runs[cell_index] += scheduled_runs;
+
+        WorkQueue& queue = queues[index];
+        lock_guard<mutex> lock(queue.lock);
+        for (int i = runs - 1; i > 0; --i) {
+            if (cell.plan.duplicate_of[i] < 0) queue.tasks.push_back({ cell_index, i });
+        }
+    }
+
+    // Лучший прогон как в Solver: первый с наибольшей оценкой
+    void finishCell(int index) {
+        SolverContext& cell = cells[index];
+
+        int best = 0;
+        for (int i = 1; i < cell.orders_count; ++i) {
+            if (cell.run_values[i] > cell.run_values[best]) best = i;
+        }
+        for (int i = 1; i < cell.orders_count; ++i) {
+            if (cell.run_values[i] >= 0) recordStrategyRun(cell.order_strategy[i], cell.run_values[i], cell.run_values[0]);
+        }
+        recordBestTestIndex(best == 0 ? 1 : order_strategies[cell.order_strategy[best]].test_index);
+
+        cell.result = cell.run_results[best];
+        cell.actual_user_intervals = cell.run_bounds[best];
+        finishSolution(cell, (*answers)[index]);
+        finishLatency(index);
+    }
+
+    void finishLatency(int index) {
+        latencies[index] = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - cells[index].start_time).count() / 1000.0;
+        if (isSolverCaptureEnabled()) {
+            const SolverTask& input = tasks[index];
+            captureInstance(input.N, input.M, input.K, input.J, input.L, *input.reserved, *input.users, (*answers)[index], latencies[index]);
+        }
+        --remaining_cells;
+    }
+
+    void fillStats(BatchStats& stats, int count, double seconds) {
+        stats.cells = count;
+        stats.threads = threads_count;
+        stats.seconds = seconds;
+        stats.cells_per_second = seconds > 0 ? count / seconds : 0;
+
+        vector<double> sorted(latencies.begin(), latencies.begin() + count);
+        sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) { return sorted.empty() ? 0.0 : sorted[min((int)sorted.size() - 1, (int)(p * sorted.size()))]; };
+        stats.latency_p50_us = percentile(0.50);
+        stats.latency_p95_us = percentile(0.95);
+        stats.latency_p99_us = percentile(0.99);
+        stats.latency_max_us = sorted.empty() ? 0.0 : sorted.back();
+    }
+};
+
+/// <summary>
+/// Постоянные потоки для параллельных циклов SolverEvolve и SolverHierarchical: потоки создаются один раз
+/// и ждут следующего задания, их рабочая память Solver переиспользуется между заданиями
+/// </summary>
+struct WorkerPool {
+    int threads_count = 1;
+    vector<thread> workers;
+
+    // задание: job(job_data) на потоках с номером меньше job_threads, поток 0 - вызывающий
+    void (*job)(void*) = nullptr;
+    void* job_data = nullptr;
+    int job_threads = 0;
+    atomic<int> busy_workers{ 0 };
+
+    mutex wake_lock;
+    condition_variable wake;
+    int generation = 0;
+    bool stopping = false;
+
+    explicit WorkerPool(int threads) {
+        threads_count = max(1, threads);
+        for (int i = 1; i < threads_count; ++i) workers.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(wake_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // body() выполняется на threads потоках, включая вызывающий; возврат после завершения всех
+    template <typename Body> void run(int threads, Body& body) {
+        job = [](void* data) { (*(Body*)data)(); };
+        job_data = &body;
+        job_threads = min(threads, threads_count);
+        if (job_threads > 1) {
+            {
+                lock_guard<mutex> lock(wake_lock);
+                busy_workers = threads_count - 1;
+                ++generation;
+            }
+            wake.notify_all();
+        }
+        body();
+        while (busy_workers > 0) this_thread::yield();
+    }
+
+    void workerLoop(int index) {
+        int seen_generation = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(wake_lock);
+                wake.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) return;
+                seen_generation = generation;
+            }
+            if (index < job_threads) job(job_data);
+            --busy_workers;
+        }
+    }
+};
+
+// Общий пул, растёт до наибольшего запрошенного числа потоков. Задания из разных потоков идут по очереди
+mutex worker_pool_lock;
+unique_ptr<WorkerPool> worker_pool;
+
+template <typename Body> void runOnWorkerPool(int threads, Body& body) {
+    if (threads <= 1) {
+        body();
+        return;
+    }
+    lock_guard<mutex> lock(worker_pool_lock);
+    if (worker_pool == nullptr || worker_pool->threads_count < threads) {
+        worker_pool.reset();
+        worker_pool.reset(new WorkerPool(threads));
+    }
+    worker_pool->run(threads, body);
+}
+
+/// <summary>
+/// Параметры эволюционного поиска порядка пользователей
+/// </summary>
+struct EvolutionParams {
+    int population = 24;
+    // лучшие особи переходят в следующее поколение без изменений
+    int elite = 2;
+    int tournament = 3;
+    float crossover_rate = 0.9f;
+    float mutation_rate = 0.6f;
+    // мутация двигает пользователя не дальше чем на mutation_span позиций
+    int mutation_span = 16;
+    double time_budget_ms = 1000;
+    // 0 - по числу ядер
+    int threads = 0;
+};
+
+// Лучшая и средняя оценка поколения к моменту ms от начала поиска
+struct EvolutionPoint {
+    double ms;
+    int generation;
+    float best_value;
+    float mean_value;
+};
+
+/// <summary>
+/// Оценка порядков population[from..to) прогоном realSolver на threads потоках общего пула, оценка в values
+/// </summary>
+inline void evaluateOrders(const SolverContext& context, const vector<vector<UserId>>& population, int from, int to, int threads, vector<float>& values) {
+    atomic<int> next{ from };
+    auto worker = [&]() {
+        loadSolverInstance(context);
+        vector<MaskedInterval> result;
+        for (int i = next++; i < to; i = next++) {
+            values[i] = realSolver(context.N, context.M, context.K, context.J, context.max_insertions, context.intervals, population[i], result) ?
+                checker(context.N, context.M, context.K, context.J, context.max_insertions, context.max_test_score) : 0;
+        }
+    };
+
+    runOnWorkerPool(min(threads, to - from), worker);
+}
+
+// Порядковый кроссовер (OX): отрезок [a, b) берётся из first, остальные позиции по порядку из second
+inline void orderCrossover(const vector<UserId>& first, const vector<UserId>& second, vector<UserId>& child, vector<char>& taken, mt19937& rng) {
+    int n = (int)first.size();
+    int a = uniform_int_distribution<int>(0, n - 1)(rng);
+    int b = uniform_int_distribution<int>(0, n - 1)(rng);
+    if (a > b) swap(a, b);
+    ++b;
+
+    taken.assign(n, 0);
+    child.resize(n);
+    for (int i = a; i < b; ++i) {
+        child[i] = first[i];
+        taken[first[i]] = 1;
+    }
+    int position = 0;
+    for (UserId u : second) {
+        if (taken[u]) continue;
+        if (position == a) position = b;
+        child[position++] = u;
+    }
+}
+
+// Перенос пользователя на соседнюю позицию или обмен двух близких: порядок остаётся почти отсортированным
+inline void mutateOrder(vector<UserId>& order, int span, mt19937& rng) {
+    int n = (int)order.size();
+    if (n < 2) return;
+    int from = uniform_int_distribution<int>(0, n - 1)(rng);
+    int to = uniform_int_distribution<int>(max(0, from - span), min(n - 1, from + span))(rng);
+    if (from == to) return;
+
+    if (rng() & 1) {
+        swap(order[from], order[to]);
+    }
+    else if (from < to) {
+        rotate(order.begin() + from, order.begin() + from + 1, order.begin() + to + 1);
+    }
+    else {
+        rotate(order.begin() + to, order.begin() + from, order.begin() + from + 1);
+    }
+}
+
+/// <summary>
+/// Эволюционный поиск порядка пользователей: realSolver переводит порядок в расписание,
+/// оценка checker - приспособленность. Начальная популяция - порядки прогонов Solver,
+/// поэтому результат не хуже Solver без ограничения времени. Поиск идёт до исчерпания
+/// params.time_budget_ms или до оптимальной оценки, в convergence пишется оценка по поколениям
+/// </summary>
+void SolverEvolve(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos, const EvolutionParams& params,
+    vector<Interval>& answer, vector<EvolutionPoint>* convergence = nullptr) {
+
+    SolverContext& context = solver_context;
+    if (convergence != nullptr) convergence->clear();
+
+    if (J == 1) {
+        solveSingleInterval(context, M, L, reservedRBs, userInfos, answer);
+        return;
+    }
+
+    unsigned int seed = getSolverSeed();
+    mt19937 rng(seed);
+
+    if (!prepareSolverRuns(context, N, M, K, J, L, reservedRBs, userInfos, seed)) {
+        answer.clear();
+        CHECK_ANSWER(answer, M, J, L, reservedRBs);
+        return;
+    }
+    addStrategyRuns(context, INT_MAX);
+
+    int population_size = max(params.population, params.elite + 2);
+    int elite = max(1, params.elite);
+    int threads = params.threads > 0 ? params.threads : max(1, (int)thread::hardware_concurrency());
+
+    // Начальная популяция - различные порядки прогонов Solver, остаток - мутанты базового порядка
+    vector<vector<UserId>> population, offspring;
+    for (int i = 0; i < context.orders_count && (int)population.size() < population_size; ++i) {
+        if (context.plan.duplicate_of[i] < 0) population.push_back(context.orders[i]);
+    }
+    while ((int)population.size() < population_size) {
+        population.push_back(context.orders[0]);
+        mutateOrder(population.back(), params.mutation_span, rng);
+    }
+
+    vector<float> values(population_size), offspring_values(population_size);
+    vector<int> ranking(population_size);
+    vector<char> taken;
+
+    auto pick = [&]() {
+        int best = uniform_int_distribution<int>(0, population_size - 1)(rng);
+        for (int k = 1; k < params.tournament; ++k) {
+            int other = uniform_int_distribution<int>(0, population_size - 1)(rng);
+            if (values[other] > values[best]) best = other;
+        }
+        return best;
+    };
+    uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+    evaluateOrders(context, population, 0, population_size, threads, values);
+
+    for (int generation = 0; ; ++generation) {
+        for (int i = 0; i < population_size; ++i) ranking[i] = i;
+        stable_sort(ranking.begin(), ranking.end(), [&](int l, int r) { return values[l] > values[r]; });
+
+        float best_value = values[ranking[0]];
+        if (convergence != nullptr) {
+            float mean_value = 0;
+            for (float value : values) mean_value += value;
+            double ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - context.start_time).count() / 1000.0;
+            convergence->push_back({ ms, generation, best_value, mean_value / population_size });
+        }
+
+        if (best_value >= context.optimal_value) break;
+        if (chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - context.start_time).count() >= params.time_budget_ms * 1000) break;
+
+        // Элита без повторной оценки, остальные - потомки турнирного отбора
+        offspring.resize(population_size);
+        for (int i = 0; i < elite; ++i) {
+            offspring[i] = population[ranking[i]];
+            offspring_values[i] = values[ranking[i]];
+        }
+        for (int i = elite; i < population_size; ++i) {
+            int first = pick();
+            if (chance(rng) < params.crossover_rate) orderCrossover(population[first], population[pick()], offspring[i], taken, rng);
+            else offspring[i] = population[first];
+            if (chance(rng) < params.mutation_rate) mutateOrder(offspring[i], params.mutation_span, rng);
+        }
+
+        evaluateOrders(context, offspring, elite, population_size, threads, offspring_values);
+        swap(population, offspring);
+        swap(values, offspring_values);
+    }
+
+    // Расписание лучшего порядка восстанавливается повторным прогоном, он детерминирован
+    int best = (int)(max_element(values.begin(), values.end()) - values.begin());
+    loadSolverInstance(context);
+    if (!realSolver(N, M, K, J, context.max_insertions, context.intervals, population[best], context.result)) {
+        realSolver(N, M, K, J, context.max_insertions, context.intervals, context.orders[0], context.result);
+    }
+    context.actual_user_intervals.assign(user_intervals.begin(), user_intervals.end());
+    finishSolution(context, answer);
+}
+
+/// <summary>
+/// Параметры двухуровневого решения для больших N
+/// </summary>
+struct HierarchyParams {
+    // пользователей на группу, по нему выбирается число групп
+    int group_users = 512;
+    // интервалов на группу не меньше, иначе групп меньше
+    int min_group_intervals = 4;
+    // 0 - число групп по group_users
+    int groups = 0;
+    // 0 - по числу ядер
+    int threads = 0;
+};
+
+/// <summary>
+/// Группа двухуровневого решения: отрезок блоков [start, end) со своей долей J и пользователей.
+/// Экземпляр группы самостоятельный: блоки и пользователи перенумерованы с нуля
+/// </summary>
+struct HierarchyGroup {
+    int start = 0, end = 0;
+    // свободных блоков в отрезке
+    int capacity = 0;
+    int J = 0;
+    vector<Interval> reserved;
+    vector<UserInfo> users;
+    // id пользователя группы -> id исходного экземпляра
+    vector<int> user_ids;
+    vector<Interval> answer;
+    // суммарная потребность группы и по лучам, с ограничением capacity на пользователя
+    long long load = 0;
+    long long beam_load[32];
+    // пользователей луча в группе: в интервале не больше одного пользователя луча
+    int beam_users[32];
+};
+
+/// <summary>
+/// Корзина пользователей одного beam и одного диапазона rbNeed [2^k, 2^(k+1)),
+/// крупные корзины делятся на части, чтобы раздаваться по группам
+/// </summary>
+struct UserBucket {
+    int beam;
+    // k диапазона rbNeed
+    int range;
+    long long need;
+    // пользователи корзины - users_sorted[from..to)
+    int from, to;
+};
+
+struct HierarchyWorkspace {
+    vector<MaskedInterval> free_intervals;
+    vector<HierarchyGroup> groups;
+    vector<uint64_t> keys;
+    vector<UserId> users_sorted;
+    vector<UserBucket> buckets;
+};
+
+thread_local HierarchyWorkspace hierarchy_workspace;
+
+/// <summary>
+/// Отрезки групп: свободные блоки делятся на groups_count частей поровну,
+/// J - пропорционально числу свободных блоков
+/// </summary>
+inline void buildHierarchyGroups(HierarchyWorkspace& workspace, int M, int J, int groups_count, const vector<Interval>& reservedRBs) {
+    vector<MaskedInterval>& free_intervals = workspace.free_intervals;
+    getNonReservedIntervals(reservedRBs, M, free_intervals);
+    long long free_total = 0;
+    for (const auto& interval : free_intervals) free_total += interval.getLength();
+
+    vector<HierarchyGroup>& groups = workspace.groups;
+    groups.resize(groups_count);
+    int segment = 0;
+    long long before = 0;
+    int position = 0;
+    for (int g = 0; g < groups_count; ++g) {
+        HierarchyGroup& group = groups[g];
+        group.start = position;
+        // конец группы - блок, до которого набирается её доля свободных блоков
+        long long target = free_total * (g + 1) / groups_count;
+        while (segment < (int)free_intervals.size() && before + free_intervals[segment].getLength() <= target) {
+            before += free_intervals[segment].getLength();
+            position = free_intervals[segment].end;
+            ++segment;
+        }
+        if (segment < (int)free_intervals.size() && before < target) position = free_intervals[segment].start + (int)(target - before);
+        if (g == groups_count - 1) position = M;
+        group.end = position;
+
+        group.capacity = 0;
+        for (const auto& interval : free_intervals) group.capacity += max(0, min(interval.end, group.end) - max(interval.start, group.start));
+        group.J = (int)((long long)J * (g + 1) / groups_count - (long long)J * g / groups_count);
+
+        group.reserved.clear();
+        for (const auto& R : reservedRBs) {
+            int start = max(R.start, group.start), end = min(R.end, group.end);
+            if (start < end) group.reserved.push_back(Interval(start - group.start, end - group.start));
+        }
+        group.users.clear();
+        group.user_ids.clear();
+        group.load = 0;
+        fill(group.beam_load, group.beam_load + 32, 0LL);
+        fill(group.beam_users, group.beam_users + 32, 0);
+    }
+}
+
+/// <summary>
+/// Грубый уровень: пользователи группируются в корзины по beam и диапазону rbNeed, корзины по убыванию
+/// потребности раздаются группам с наименьшей загрузкой. Загрузка группы - наибольшая из доли занятых
+/// строк луча и доли занятых строк всей группы, так у каждой группы получается смесь лучей
+/// </summary>
+inline void assignHierarchyBuckets(HierarchyWorkspace& workspace, int L, const vector<UserInfo>& userInfos) {
+    vector<HierarchyGroup>& groups = workspace.groups;
+    int groups_count = (int)groups.size();
+    int N = (int)userInfos.size();
+
+    uint32_t beams = 0;
+    for (const auto& user : userInfos) beams |= 1u << user.beam;
+    int rows = max(1, min(L, popCount64(beams)));
+
+    // beam по возрастанию, затем rbNeed по убыванию: корзина - отрезок этого порядка
+    vector<uint64_t>& keys = workspace.keys;
+    keys.resize(N);
+    for (int i = 0; i < N; ++i) keys[i] = packUserKey(0xFFFF - userInfos[i].beam, userInfos[i].rbNeed, i);
+    sortIdsByPackedKeys(keys, workspace.users_sorted);
+    const vector<UserId>& users_sorted = workspace.users_sorted;
+
+    int group_capacity = max(1, groups[0].capacity);
+    vector<UserBucket>& buckets = workspace.buckets;
+    buckets.clear();
+    for (int from = 0; from < N; ) {
+        const UserInfo& first = userInfos[users_sorted[from]];
+        int to = from;
+        while (to < N && userInfos[users_sorted[to]].beam == first.beam && highestBit64(userInfos[users_sorted[to]].rbNeed) == highestBit64(first.rbNeed)) ++to;
+
+        // части корзины не меньше пользователя и не крупнее доли одной группы
+        int part = max(1, (to - from + groups_count - 1) / groups_count);
+        for (int k = from; k < to; k += part) {
+            UserBucket bucket = { first.beam, highestBit64(first.rbNeed), 0, k, min(to, k + part) };
+            for (int i = bucket.from; i < bucket.to; ++i) bucket.need += min(userInfos[users_sorted[i]].rbNeed, group_capacity);
+            buckets.push_back(bucket);
+        }
+        from = to;
+    }
+    // Крупные пользователи раздаются первыми, как в порядке обхода realSolver
+    sort(buckets.begin(), buckets.end(), [](const UserBucket& l, const UserBucket& r) {
+        return l.range > r.range || (l.range == r.range && (l.need > r.need || (l.need == r.need && l.from < r.from)));
+    });
+
+    for (const auto& bucket : buckets) {
+        int best = -1;
+        double best_load = 0;
+        for (int g = 0; g < groups_count; ++g) {
+            const HierarchyGroup& group = groups[g];
+            if (group.capacity == 0 || group.J == 0) continue;
+            int bucket_users = bucket.to - bucket.from;
+            double load = max((double)(group.beam_load[bucket.beam] + bucket.need) / group.capacity,
+                (double)(group.load + bucket.need) / ((double)group.capacity * rows));
+            load = max(load, max((double)(group.beam_users[bucket.beam] + bucket_users) / group.J,
+                (double)(group.users.size() + bucket_users) / ((double)group.J * rows)));
+            if (best == -1 || load < best_load) {
+                best = g;
+                best_load = load;
+            }
+        }
+        if (best == -1) break;
+
+        HierarchyGroup& group = groups[best];
+        group.load += bucket.need;
+        group.beam_load[bucket.beam] += bucket.need;
+        group.beam_users[bucket.beam] += bucket.to - bucket.from;
+        for (int i = bucket.from; i < bucket.to; ++i) {
+            const UserInfo& user = userInfos[users_sorted[i]];
+            group.users.push_back({ user.rbNeed, user.beam, (int)group.users.size() });
+            group.user_ids.push_back(user.id);
+        }
+    }
+}
+
+/// <summary>
+/// Двухуровневое решение для больших N: свободные блоки делятся на отрезки-группы со своей долей J,
+/// корзины пользователей (beam, диапазон rbNeed) раздаются группам, затем каждая группа решается
+/// обычным Solver как отдельный экземпляр, группы - параллельно на params.threads потоках общего пула.
+/// Зерно группы зависит только от её номера, а не от потока, который её решает.
+/// Ответы групп не пересекаются и вместе дают не больше J интервалов.
+/// Возвращает число групп, 1 - экземпляр мал и решён обычным Solver.
+/// При нескольких потоках статистика стратегий обновляется в разном порядке, ответ может отличаться
+/// от ответа на одном потоке
+/// </summary>
+int SolverHierarchical(int N, int M, int K, int J, int L, const vector<Interval>& reservedRBs, const vector<UserInfo>& userInfos, const HierarchyParams& params,
+    vector<Interval>& answer) {
+
+    int groups_count = params.groups > 0 ? params.groups : (N + params.group_users - 1) / max(1, params.group_users);
+    groups_count = min(groups_count, J / max(1, params.min_group_intervals));
+    if (groups_count <= 1) {
+        solveInstance(N, M, K, J, L, reservedRBs, userInfos, answer, getSolverSeed());
+        return 1;
+    }
+
+    HierarchyWorkspace& workspace = hierarchy_workspace;
+    buildHierarchyGroups(workspace, M, J, groups_count, reservedRBs);
+    assignHierarchyBuckets(workspace, L, userInfos);
+    vector<HierarchyGroup>& groups = workspace.groups;
+
+    // Точный уровень: группы решаются независимо, состояние Solver своё у каждого потока
+    int threads = params.threads > 0 ? params.threads : max(1, (int)thread::hardware_concurrency());
+    unsigned int seed = getSolverSeed();
+    atomic<int> next{ 0 };
+    auto worker = [&]() {
+        for (int g = next++; g < groups_count; g = next++) {
+            HierarchyGroup& group = groups[g];
+            if (group.users.empty()) {
+                group.answer.clear();
+                continue;
+            }
+            solveInstance((int)group.users.size(), group.end - group.start, (int)group.reserved.size(), group.J, L, group.reserved, group.users, group.answer, getInstanceSeed(seed, g));
+        }
+    };
+    runOnWorkerPool(min(threads, groups_count), worker);
+
+    int j = 0;
+    for (const auto& group : groups) {
+        for (const auto& interval : group.answer) {
+            if ((int)answer.size() == j) answer.emplace_back();
+            Interval& merged = answer[j++];
+            merged.start = interval.start + group.start;
+            merged.end = interval.end + group.start;
+            merged.users.clear();
+            for (int user : interval.users) merged.users.push_back(group.user_ids[user]);
+        }
+    }
+    while ((int)answer.size() > j) answer.pop_back();
+
+#ifdef SOLVER_CHECK_INVARIANTS
+    user_table.assign(userInfos);
+    CHECK_ANSWER(answer, M, J, L, reservedRBs);
+#endif
+    return groups_count;
+}
+
+inline bool realSolver(int N, int M, int K, int J, int L, const vector<MaskedInterval>& reservedRBs, const vector<UserId>& user_infos, vector<MaskedInterval>& result,
+    const SolverCheckpoint* resume, SolverCheckpoint* checkpoints, int checkpoints_count) {
+
+    vector<MaskedInterval>& intervals = solver_workspace.run_intervals;
+    DeferredSet& deferred = solver_workspace.deferred;
+    deferred.clear();
+
+    int attempt = 0;
+
+    int user_index = 0;
+    if (resume != nullptr) {
+        intervals = resume->intervals;
+        user_intervals.assign(resume->user_intervals.begin(), resume->user_intervals.end());
+        deferred = resume->deferred;
+        user_index = resume->position;
+    }
+    else {
+        intervals = reservedRBs;
+        user_intervals.assign((int)user_infos.size(), { -1, -1 });
+    }
+    invalidateIntervalsLayout();
+
+    int next_checkpoint = 0;
+    while (next_checkpoint < checkpoints_count && checkpoints[next_checkpoint].position < user_index) ++next_checkpoint;
+
+    while (user_index < user_infos.size()) {
+        TRACE_STEP(intervals);
+        CHECK_SCHEDULE(intervals, M, L, deferred);
+
+        // attempt == 0 только перед первой попыткой вставить очередного пользователя
+        if (attempt == 0 && next_checkpoint < checkpoints_count && checkpoints[next_checkpoint].position == user_index) {
+            SolverCheckpoint& checkpoint = checkpoints[next_checkpoint++];
+            checkpoint.intervals = intervals;
+            checkpoint.user_intervals.assign(user_intervals.begin(), user_intervals.end());
+            checkpoint.deferred = deferred;
+            checkpoint.ready = true;
+        }
+
+        ++attempt;
+        bool inserted = false;
+        const UserInfo user = user_table.get(user_infos[user_index]);
+
+        int insertion_index = findInsertIndex(intervals, user, L);
+
+        // Eсли нет пустой ячейки то попробовать заменить что-то
+        if (insertion_index >= 0) {
+            if (!intervals[insertion_index].insertNewUser(user)) return false;
+            inserted = true;
+            CHECK_SCHEDULE(intervals, M, L, deferred);
+        }
+        else {
+            bool success = false;
+            auto it = deferred.begin();
+            while (it != deferred.end()) {
+                StepStatus result = tryReplaceUser(intervals, user_table.get(*it), 2, 250, L, deferred, true);
+                if (result == STEP_FAILED) return false;
+                auto last_it = it;
+                ++it;
+                if (result == STEP_DONE) {
+                    success = true;
+                    deferred.erase(last_it);
+                    CHECK_SCHEDULE(intervals, M, L, deferred);
+                }
+            }
+            if (success) continue;
+        }
+
+        if (inserted || attempt >= max_attempts) {
+            if (!inserted) {
+                deferred.insert(user.id);
+            }
+            attempt = 0;
+            ++user_index;
+        }
+        else {
+            if (intervals.size() < J) {
+                if (intervals[0].getLength() > user.rbNeed) {
+                    float loss_threshold_multiplier = getLossThresholdMultiplier(user_index, N);
+
+                    // Заменить слишком больших пользователей на тех кто поменьше и разделить
+                    int split_index = findIntervalToSplit(intervals, user, loss_threshold_multiplier, L);
+                    if (split_index != -1) {
+                        auto it = deferred.begin();
+                        while (it != deferred.end()) {
+                            StepStatus result = tryReduceUser(intervals, user_table.get(*it), 0, deferred);
+                            if (result == STEP_FAILED) return false;
+                            auto last_it = it;
+                            ++it;
+                            if (result == STEP_DONE) {
+                                deferred.erase(last_it);
+                                CHECK_SCHEDULE(intervals, M, L, deferred);
+                            }
+                        }
+                        if (!splitRoutine(intervals, user, split_index, loss_threshold_multiplier)) return false;
+                        if (!reinsertRoutine(intervals, N, L)) return false;
+                        CHECK_SCHEDULE(intervals, M, L, deferred);
+                        continue;
+                    }
+                }
+            }
+
+            // Так плохо писать, но код выполнится, только если разделение не произошло
+            attempt = max_attempts + 1;
+        }
+    }
+
+    // оптимизация перезаполнения
+    if (!reinsertRoutine(intervals, N, L)) return false;
+    CHECK_SCHEDULE(intervals, M, L, deferred);
+
+    {
+        auto it = deferred.begin();
+        while (it != deferred.end()) {
+            StepStatus result = tryReduceUser(intervals, user_table.get(*it), 0, deferred);
+            if (result == STEP_FAILED) return false;
+            auto last_it = it;
+            ++it;
+            if (result == STEP_DONE) {
+                deferred.erase(last_it);
+                CHECK_SCHEDULE(intervals, M, L, deferred);
+            }
+        }
+    }
+
+    // Последняя попытка вставить
+    for (int i = 0; i < 10 * max_attempts; ++i) {
+        CHECK_SCHEDULE(intervals, M, L, deferred);
+
+        // довставить
+        bool success = false;
+        auto it = deferred.begin();
+        while (it != deferred.end()) {
+            StepStatus result = tryReplaceUser(intervals, user_table.get(*it), 0, 10000, L, deferred, true);
+            if (result == STEP_FAILED) return false;
+            auto last_it = it;
+            ++it;
+            if (result == STEP_DONE) {
+                success = true;
+                deferred.erase(last_it);
+                CHECK_SCHEDULE(intervals, M, L, deferred);
+            }
+        }
+        if (success) continue;
+
+        if (intervals.size() >= J || deferred.size() == 0) break;
+        float loss_threshold_multiplier = getLossThresholdMultiplier(N - (int)deferred.size(), N);
+
+        int split_index = findIntervalToSplit(intervals, user_table.get(*deferred.begin()), loss_threshold_multiplier, L);
+        if (split_index >= 0) {
+            if (!splitRoutine(intervals, user_table.get(*deferred.begin()), split_index, loss_threshold_multiplier)) return false;
+            if (!reinsertRoutine(intervals, N, L)) return false;
+            CHECK_SCHEDULE(intervals, M, L, deferred);
+        }
+        else {
+            deferred.erase(deferred.begin());
+        }
+    }
+
+    CHECK_SCHEDULE(intervals, M, L, deferred);
+    TRACE_STEP(intervals);
+    // буферы меняются местами, память обоих остаётся в работе
+    swap(result, intervals);
+    return true;
+}
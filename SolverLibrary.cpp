@@ -0,0 +1,101 @@
+﻿#define SOLVER_LIBRARY_BUILD
+
+#include "SolverLibrary.h"
+#include "Solution.h"
+
+// Пул переиспользуется между пакетами, пересоздаётся при смене числа потоков
+mutex batch_solver_lock;
+unique_ptr<BatchSolver> batch_solver;
+int batch_solver_threads = -1;
+
+// Буферы перевода плоских массивов в векторы решателя, свои у каждого потока вызывающего
+thread_local vector<Interval> library_reserved;
+thread_local vector<UserInfo> library_users;
+thread_local vector<Interval> library_answer;
+
+// Полностью зарезервированный экземпляр корректен: решатель возвращает для него пустой ответ
+inline bool isValidInstance(const SolverInstance& instance) {
+    if (instance.N < 0 || instance.N > 0xFFFF || instance.M <= 0 || instance.K < 0 || instance.J <= 0 || instance.L <= 0) return false;
+    if ((instance.K > 0 && instance.reserved == nullptr) || (instance.N > 0 && instance.users == nullptr)) return false;
+
+    for (int i = 0; i < instance.K; ++i) {
+        int start = instance.reserved[2 * i], end = instance.reserved[2 * i + 1];
+        if (start < 0 || start >= end || end > instance.M) return false;
+    }
+    for (int i = 0; i < instance.N; ++i) {
+        int rbNeed = instance.users[2 * i], beam = instance.users[2 * i + 1];
+        if (rbNeed <= 0 || beam < 0 || beam >= 32) return false;
+    }
+    return true;
+}
+
+inline bool isValidOutput(const SolverOutput* output) {
+    return output != nullptr && output->intervals != nullptr && output->users != nullptr;
+}
+
+inline void readInstance(const SolverInstance& instance, vector<Interval>& reserved, vector<UserInfo>& users) {
+    reserved.resize(instance.K);
+    for (int i = 0; i < instance.K; ++i) {
+        reserved[i].start = instance.reserved[2 * i];
+        reserved[i].end = instance.reserved[2 * i + 1];
+    }
+    users.resize(instance.N);
+    for (int i = 0; i < instance.N; ++i) users[i] = { instance.users[2 * i], instance.users[2 * i + 1], i };
+}
+
+inline void writeOutput(const SolverInstance& instance, const vector<Interval>& answer, SolverOutput& output) {
+    output.intervals_count = (int32_t)answer.size();
+    for (int i = 0; i < (int)answer.size(); ++i) {
+        output.intervals[3 * i] = answer[i].start;
+        output.intervals[3 * i + 1] = answer[i].end;
+        output.intervals[3 * i + 2] = (int32_t)answer[i].users.size();
+        for (int k = 0; k < (int)answer[i].users.size(); ++k) output.users[i * instance.L + k] = answer[i].users[k];
+    }
+}
+
+int32_t solver_api_version(void) {
+    return SOLVER_API_VERSION;
+}
+
+void solver_set_seed(uint32_t seed) {
+    setSolverSeed(seed);
+}
+
+int32_t solver_solve(const SolverInstance* instance, SolverOutput* output) {
+    if (instance == nullptr || !isValidInstance(*instance) || !isValidOutput(output)) return SOLVER_INVALID_ARGUMENT;
+
+    readInstance(*instance, library_reserved, library_users);
+    SolverInto(instance->N, instance->M, instance->K, instance->J, instance->L, library_reserved, library_users, library_answer);
+    writeOutput(*instance, library_answer, *output);
+    return SOLVER_OK;
+}
+
+int32_t solver_solve_batch(const SolverInstance* instances, SolverOutput* outputs, int32_t count, int32_t threads) {
+    if (count < 0 || (count > 0 && (instances == nullptr || outputs == nullptr))) return SOLVER_INVALID_ARGUMENT;
+    for (int i = 0; i < count; ++i) {
+        if (!isValidInstance(instances[i]) || !isValidOutput(&outputs[i])) return SOLVER_INVALID_ARGUMENT;
+    }
+
+    vector<vector<Interval>> reserved(count);
+    vector<vector<UserInfo>> users(count);
+    vector<SolverTask> batch(count);
+    for (int i = 0; i < count; ++i) {
+        const SolverInstance& instance = instances[i];
+        readInstance(instance, reserved[i], users[i]);
+        batch[i] = { instance.N, instance.M, instance.K, instance.J, instance.L, &reserved[i], &users[i] };
+    }
+
+    vector<vector<Interval>> answers;
+    {
+        lock_guard<mutex> lock(batch_solver_lock);
+        if (batch_solver == nullptr || batch_solver_threads != threads) {
+            batch_solver.reset();
+            batch_solver.reset(new BatchSolver(threads));
+            batch_solver_threads = threads;
+        }
+        batch_solver->solve(batch, answers);
+    }
+
+    for (int i = 0; i < count; ++i) writeOutput(instances[i], answers[i], outputs[i]);
+    return SOLVER_OK;
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+/// <summary>
+/// C ABI решателя для подключения из других языков (solver_library.py) и планировщиков.
+/// Входные данные - плоские массивы int32, ответ пишется в буферы вызывающего.
+/// Заголовок не тянет Solution.h, поэтому его глобальные имена не попадают к вызывающему
+/// </summary>
+
+#if defined(_WIN32)
+#if defined(SOLVER_LIBRARY_BUILD)
+#define SOLVER_EXPORT __declspec(dllexport)
+#else
+#define SOLVER_EXPORT __declspec(dllimport)
+#endif
+#else
+#define SOLVER_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Меняется при любом несовместимом изменении структур и функций ниже
+#define SOLVER_API_VERSION 1
+
+#define SOLVER_OK 0
+#define SOLVER_INVALID_ARGUMENT -1
+
+/// <summary>
+/// Экземпляр в формате open.txt. reserved - K пар (start, end), users - N пар (rbNeed, beam),
+/// id пользователя - его номер в users
+/// </summary>
+typedef struct SolverInstance {
+    int32_t N, M, K, J, L;
+    const int32_t* reserved;
+    const int32_t* users;
+} SolverInstance;
+
+/// <summary>
+/// Буферы ответа, выделяет вызывающий: intervals - 3 * J значений (start, end, число пользователей),
+/// users - J * L значений, пользователи интервала i лежат с позиции i * L.
+/// intervals_count заполняет решатель
+/// </summary>
+typedef struct SolverOutput {
+    int32_t* intervals;
+    int32_t* users;
+    int32_t intervals_count;
+} SolverOutput;
+
+SOLVER_EXPORT int32_t solver_api_version(void);
+
+/// <summary>
+/// 0 - новое зерно по времени в каждом вызове, иначе фиксированное. Случайные порядки экземпляра зависят
+/// только от зерна (в пакете - от зерна и номера экземпляра), но выбор стратегий учитывает статистику
+/// прошлых вызовов процесса. Поэтому одна и та же последовательность вызовов в одном потоке и пакет
+/// при threads = 1 воспроизводимы, а при threads > 1 порядок завершения экземпляров меняет статистику
+/// и ранний останов по оптимальной оценке, и ответы могут отличаться между запусками
+/// </summary>
+SOLVER_EXPORT void solver_set_seed(uint32_t seed);
+
+// Возвращает SOLVER_OK или SOLVER_INVALID_ARGUMENT, тогда output не изменяется.
+// Если reserved покрывают все M блоков, экземпляр корректен и ответ пустой: intervals_count = 0
+SOLVER_EXPORT int32_t solver_solve(const SolverInstance* instance, SolverOutput* output);
+
+/// <summary>
+/// Решает count экземпляров на threads потоках (0 - по числу ядер), ответ экземпляра i пишется в outputs[i].
+/// Пул потоков сохраняется между вызовами. Если хоть один экземпляр некорректен, ничего не решается
+/// </summary>
+SOLVER_EXPORT int32_t solver_solve_batch(const SolverInstance* instances, SolverOutput* outputs, int32_t count, int32_t threads);
+
+#ifdef __cplusplus
+}
+#endif
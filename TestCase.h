@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "Solution.h"
+
+using namespace std;
+
+/// <summary>
+/// Тест в формате open.txt
+/// </summary>
+struct TestCase {
+    int N, M, K, J, L;
+    vector<Interval> reserved;
+    vector<UserInfo> users;
+};
+
+inline TestCase readTestCase(istream& in) {
+    TestCase test;
+    in >> test.N >> test.M >> test.K >> test.J >> test.L;
+
+    test.reserved.resize(test.K);
+    for (int i = 0; i < test.K; i++) {
+        int start, end;
+        in >> start >> end;
+        test.reserved[i].start = start;
+        test.reserved[i].end = end;
+    }
+
+    test.users.resize(test.N);
+    for (int i = 0; i < test.N; i++) {
+        int rbNeed, beam;
+        in >> rbNeed >> beam;
+        test.users[i].id = i;
+        test.users[i].rbNeed = rbNeed;
+        test.users[i].beam = beam;
+    }
+
+    return test;
+}
+
+inline float getTestScore(const TestCase& test, const vector<Interval>& output) {
+    int output_score = 0;
+    int max_user_score = 0;
+
+    map<int, int> user_metrics;
+    for (const auto& interval : output) {
+        for (int user_id : interval.users) {
+            user_metrics[user_id] += interval.end - interval.start;
+        }
+    }
+
+    int max_test_score = test.M;
+    for (const auto& R : test.reserved) {
+        max_test_score -= R.end - R.start;
+    }
+    max_test_score *= test.L;
+
+    for (const auto& U : test.users) {
+        max_user_score += U.rbNeed;
+        output_score += min(U.rbNeed, user_metrics[U.id]);
+    }
+
+    int total_score = min(max_user_score, max_test_score);
+    // все блоки зарезервированы или никому ничего не нужно - пустой ответ лучший возможный
+    if (total_score <= 0) return 100.0f;
+    return output_score * 100.0f / total_score;
+}
+
+inline void writeTestCase(ostream& out, const TestCase& test) {
+    out << test.N << ' ' << test.M << ' ' << test.K << ' ' << test.J << ' ' << test.L << '\n';
+    for (const auto& R : test.reserved) {
+        out << R.start << ' ' << R.end << '\n';
+    }
+    for (const auto& U : test.users) {
+        out << U.rbNeed << ' ' << U.beam << '\n';
+    }
+}
+
+/// <summary>
+/// Экземпляр из журнала захвата: вход, ответ решателя, записавшего журнал, и его задержка
+/// </summary>
+struct CapturedCase {
+    TestCase test;
+    vector<Interval> answer;
+    float latency_us;
+};
+
+/// <summary>
+/// Чтение журнала startSolverCapture, формат описан у SOLVER_CAPTURE_VERSION.
+/// Возвращает false, если файл не открылся или это не журнал захвата.
+/// Оборванная последняя запись (журнал не закрыт) пропускается
+/// </summary>
+inline bool readCaptureLog(const string& path, vector<CapturedCase>& cases) {
+    ifstream in(path, ios::binary);
+    vector<uint8_t> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if ((!in.good() && !in.eof()) || bytes.size() < 6 || memcmp(bytes.data(), "SCAP", 4) != 0) return false;
+
+    size_t position = 4;
+    auto get = [&](int size) {
+        uint32_t value = 0;
+        for (int i = 0; i < size; i++) value |= (uint32_t)bytes[position++] << (8 * i);
+        return value;
+    };
+    if (get(2) != SOLVER_CAPTURE_VERSION) return false;
+
+    cases.clear();
+    while (position + 4 <= bytes.size()) {
+        uint32_t length = get(4);
+        if (position + length > bytes.size()) break;
+        size_t end = position + length;
+
+        CapturedCase record;
+        TestCase& test = record.test;
+        test.N = get(2);
+        test.M = get(4);
+        test.K = get(2);
+        test.J = get(2);
+        test.L = get(2);
+        test.reserved.resize(test.K);
+        for (auto& R : test.reserved) {
+            R.start = get(4);
+            R.end = get(4);
+        }
+        test.users.resize(test.N);
+        for (auto& U : test.users) {
+            U.rbNeed = get(4);
+            U.beam = get(1);
+            U.id = get(2);
+        }
+        uint32_t latency_bits = get(4);
+        memcpy(&record.latency_us, &latency_bits, sizeof(latency_bits));
+        record.answer.resize(get(2));
+        for (auto& interval : record.answer) {
+            interval.start = get(4);
+            interval.end = get(4);
+            interval.users.resize(get(1));
+            for (auto& u : interval.users) u = get(2);
+        }
+        cases.push_back(move(record));
+        position = end;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+import ctypes
+import os
+import sys
+
+# Сборка SolverLibrary.vcxproj, на других системах - путь из SOLVER_LIBRARY
+LIBRARY_PATH = os.environ.get('SOLVER_LIBRARY', 'x64/Release/SolverLibrary.dll')
+API_VERSION = 1
+
+SOLVER_OK = 0
+
+
+class SolverInstance(ctypes.Structure):
+    _fields_ = [('N', ctypes.c_int32), ('M', ctypes.c_int32), ('K', ctypes.c_int32),
+                ('J', ctypes.c_int32), ('L', ctypes.c_int32),
+                ('reserved', ctypes.POINTER(ctypes.c_int32)),
+                ('users', ctypes.POINTER(ctypes.c_int32))]
+
+
+class SolverOutput(ctypes.Structure):
+    _fields_ = [('intervals', ctypes.POINTER(ctypes.c_int32)),
+                ('users', ctypes.POINTER(ctypes.c_int32)),
+                ('intervals_count', ctypes.c_int32)]
+
+
+class Test:
+    '''Экземпляр в формате open.txt: reserved - список (start, end), users - список (rbNeed, beam)'''
+    def __init__(self, N, M, K, J, L, reserved, users):
+        self.N = N
+        self.M = M
+        self.K = K
+        self.J = J
+        self.L = L
+        self.reserved = reserved
+        self.users = users
+
+
+def read_tests(path='open.txt'):
+    with open(path) as f:
+        values = iter(map(int, f.read().split()))
+    tests = []
+    for _ in range(next(values)):
+        N, M, K, J, L = (next(values) for _ in range(5))
+        reserved = [(next(values), next(values)) for _ in range(K)]
+        users = [(next(values), next(values)) for _ in range(N)]
+        tests.append(Test(N, M, K, J, L, reserved, users))
+    return tests
+
+
+def get_score(test, intervals):
+    '''Оценка как getTestScore из TestCase.h, в процентах'''
+    lengths = [0] * test.N
+    for start, end, users in intervals:
+        for user in users:
+            lengths[user] += end - start
+    max_test_score = (test.M - sum(end - start for start, end in test.reserved)) * test.L
+    total = min(sum(rbNeed for rbNeed, _ in test.users), max_test_score)
+    if total <= 0:
+        return 100.0
+    return sum(min(rbNeed, lengths[i]) for i, (rbNeed, _) in enumerate(test.users)) * 100.0 / total
+
+
+class SolverLibrary:
+    '''Решатель в процессе, без запуска Project.exe на каждый тест'''
+    def __init__(self, path=LIBRARY_PATH):
+        self.lib = ctypes.CDLL(path)
+        self.lib.solver_api_version.restype = ctypes.c_int32
+        self.lib.solver_set_seed.argtypes = [ctypes.c_uint32]
+        self.lib.solver_solve.argtypes = [ctypes.POINTER(SolverInstance), ctypes.POINTER(SolverOutput)]
+        self.lib.solver_solve.restype = ctypes.c_int32
+        self.lib.solver_solve_batch.argtypes = [ctypes.POINTER(SolverInstance), ctypes.POINTER(SolverOutput), ctypes.c_int32, ctypes.c_int32]
+        self.lib.solver_solve_batch.restype = ctypes.c_int32
+
+        version = self.lib.solver_api_version()
+        if version != API_VERSION:
+            raise RuntimeError('SolverLibrary API version %d, expected %d' % (version, API_VERSION))
+
+    def set_seed(self, seed):
+        self.lib.solver_set_seed(seed)
+
+    @staticmethod
+    def _pack(test):
+        # массивы хранятся в кортеже, пока structure на них ссылается
+        reserved = (ctypes.c_int32 * max(1, 2 * test.K))(*[x for R in test.reserved for x in R])
+        users = (ctypes.c_int32 * max(1, 2 * test.N))(*[x for U in test.users for x in U])
+        instance = SolverInstance(test.N, test.M, test.K, test.J, test.L, reserved, users)
+        intervals = (ctypes.c_int32 * (3 * test.J))()
+        answer_users = (ctypes.c_int32 * (test.J * test.L))()
+        output = SolverOutput(intervals, answer_users, 0)
+        return instance, output, (reserved, users, intervals, answer_users)
+
+    @staticmethod
+    def _unpack(test, output):
+        result = []
+        for i in range(output.intervals_count):
+            start, end, count = output.intervals[3 * i], output.intervals[3 * i + 1], output.intervals[3 * i + 2]
+            result.append((start, end, [output.users[i * test.L + k] for k in range(count)]))
+        return result
+
+    def solve(self, test):
+        '''Список интервалов (start, end, users)'''
+        instance, output, buffers = self._pack(test)
+        if self.lib.solver_solve(ctypes.byref(instance), ctypes.byref(output)) != SOLVER_OK:
+            raise ValueError('invalid test')
+        return self._unpack(test, output)
+
+    def solve_batch(self, tests, threads=0):
+        '''Ответы на все тесты, решаются на пуле из threads потоков (0 - по числу ядер)'''
+        packed = [self._pack(test) for test in tests]
+        instances = (SolverInstance * len(tests))(*[p[0] for p in packed])
+        outputs = (SolverOutput * len(tests))(*[p[1] for p in packed])
+        if self.lib.solver_solve_batch(instances, outputs, len(tests), threads) != SOLVER_OK:
+            raise ValueError('invalid test in batch')
+        return [self._unpack(test, outputs[i]) for i, test in enumerate(tests)]
+
+
+def main():
+    tests = read_tests()
+    solver = SolverLibrary()
+    solver.set_seed(12345)
+    threads = int(sys.argv[1]) if len(sys.argv) > 1 else 0
+    answers = solver.solve_batch(tests, threads)
+    print('Average filled: %.5f%%' % (sum(get_score(t, a) for t, a in zip(tests, answers)) / len(tests)))
+
+
+if __name__ == '__main__':
+    main()
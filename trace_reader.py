@@ -0,0 +1,81 @@
+import struct
+
+TRACE_VERSION = 2
+
+
+class TraceRun:
+    def __init__(self, strategy):
+        # -1 - базовый отсортированный порядок, иначе индекс в order_strategies
+        self.strategy = strategy
+        self.value = None
+        # состояние интервалов после каждого шага: список (start, end, users)
+        self.steps = []
+
+
+class TraceTest:
+    def __init__(self, number, N, M, J, L):
+        self.number = number
+        self.N = N
+        self.M = M
+        self.J = J
+        self.L = L
+        self.runs = []
+
+
+def read_trace(path):
+    '''Восстанавливает полные состояния шагов из двоичной трассировки Solver (SOLVER_TRACE)'''
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'STRC':
+        raise ValueError('Not a Solver trace')
+    version, = struct.unpack_from('<H', data, 4)
+    if version != TRACE_VERSION:
+        raise ValueError(f'Trace version {version}, expected {TRACE_VERSION}')
+
+    tests = []
+    run = None
+    state = []
+    pos = 6
+    while pos < len(data):
+        tag = chr(data[pos])
+        pos += 1
+        if tag == 'T':
+            N, M, J, L = struct.unpack_from('<H3I', data, pos)
+            pos += 14
+            tests.append(TraceTest(len(tests) + 1, N, M, J, L))
+        elif tag == 'R':
+            strategy, = struct.unpack_from('<h', data, pos)
+            pos += 2
+            run = TraceRun(strategy)
+            state = []
+            tests[-1].runs.append(run)
+        elif tag == 'S':
+            # шаг заканчивается перед следующей записью 'S', 'R', 'E' или 'T'
+            end = pos
+            while end < len(data) and chr(data[end]) in 'CI':
+                if chr(data[end]) == 'C':
+                    count, = struct.unpack_from('<I', data, end + 1)
+                    state = state[:count] + [(-1, -1, [])] * (count - len(state))
+                    end += 5
+                else:
+                    index, start, stop, users_count = struct.unpack_from('<3IH', data, end + 1)
+                    users = list(struct.unpack_from(f'<{users_count}H', data, end + 15))
+                    state[index] = (start, stop, users)
+                    end += 15 + 2 * users_count
+            pos = end
+            run.steps.append(list(state))
+        elif tag == 'E':
+            run.value, = struct.unpack_from('<f', data, pos)
+            pos += 4
+        else:
+            raise ValueError(f'Unknown trace record {tag!r} at {pos - 1}')
+    return tests
+
+
+if __name__ == '__main__':
+    import sys
+    tests = read_trace(sys.argv[1] if len(sys.argv) > 1 else 'trace.bin')
+    steps = sum(len(r.steps) for t in tests for r in t.runs)
+    runs = sum(len(t.runs) for t in tests)
+    print(f'Tests: {len(tests)} Runs: {runs} Steps: {steps}')
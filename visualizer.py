@@ -3,9 +3,13 @@ import subprocess
 from sys import path
 import random
 import colorutils
+import sys
+from trace_reader import read_trace
 
 EXEC_PATH = 'x64/Release/Project.exe'
 OUTPUT_PATH = 'Visualization'
+# Трассировка сборки с SOLVER_TRACE, используется при запуске с --trace
+TRACE_PATH = 'trace.bin'
 
 class Interval:
     def __init__(self, start, end, users):
@@ -70,6 +74,18 @@ def parse_test(stdout):
     return output
     
     
+def parse_trace(path):
+    for test in read_trace(path):
+        output = []
+        for run in test.runs:
+            accuracy = '' if run.value is None else f'{run.value:.4f} strategy {run.strategy}'
+            for step in run.steps:
+                intervals_list = [Interval(start, end, users) for start, end, users in step]
+                intervals_list.sort(key=lambda x: x.start)
+                output.append(TestCase(str(test.number), accuracy, intervals_list))
+        yield output
+
+
 def render_testcase(testcase: TestCase, index: int, realTests):
     testData = realTests[int(testcase.number)-1]
     
@@ -161,6 +177,12 @@ def load_real_tests():
 def main():
     realTests = load_real_tests()    
     
+    if '--trace' in sys.argv:
+        for testcases in parse_trace(TRACE_PATH):
+            for i, case in enumerate(testcases):
+                render_testcase(case, i, realTests)
+        return
+    
     p = subprocess.Popen(EXEC_PATH, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
     while True:
         testcases = parse_test(p.stdout)